@@ -0,0 +1,148 @@
+/*! \file blktrace.c
+
+   Block I/O tracer.  Once started, it records each request in a ring
+   buffer as it is first submitted, so a request to a partition is
+   recorded once, against the partition, which tells which Pintos role
+   made it.  When the ring is full the oldest entries are overwritten.
+   At shutdown the ring is written to the scratch device in the format
+   described in lib/blktrace.h, overwriting whatever the scratch device
+   held, so do not combine -blktrace with the pintos script's -g. */
+
+#include "devices/blktrace.h"
+#include <blktrace.h>
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/*! Pages of memory given to the ring. */
+#define RING_PAGES 24
+
+/*! Number of entries in the ring. */
+#define RING_CNT (RING_PAGES * PGSIZE / sizeof (struct blktrace_entry))
+
+static struct blktrace_entry *ring;     /*!< NULL while not tracing. */
+static uint32_t recorded;               /*!< Entries ever recorded. */
+
+/*! Starts tracing.  Panics if memory for the ring is not available. */
+void blktrace_start(void) {
+    ring = palloc_get_multiple(PAL_ASSERT, RING_PAGES);
+    recorded = 0;
+}
+
+/*! Returns BLOCK's position in probe order. */
+static int device_index(struct block *block) {
+    struct block *b;
+    int idx = 0;
+
+    for (b = block_first(); b != block; b = block_next(b))
+        idx++;
+    return idx;
+}
+
+/*! Records request R, about to be submitted to BLOCK.  SYNC says whether
+    the submitter will wait for it. */
+void blktrace_record(struct block *block, const struct block_request *r,
+                     bool sync) {
+    struct blktrace_entry e;
+    enum intr_level old_level;
+
+    if (ring == NULL)
+        return;
+
+    e.time_us = timer_cycles_to_us(timer_cycles());
+    e.sector = r->sector;
+    e.cnt = r->cnt;
+    e.dev = device_index(block);
+    e.flags = (r->write ? BLKTRACE_WRITE : 0) | (sync ? BLKTRACE_SYNC : 0);
+
+    /* Submitters run in many threads, and an entry is cheaper to store
+       than a lock is to take. */
+    old_level = intr_disable();
+    ring[recorded++ % RING_CNT] = e;
+    intr_set_level(old_level);
+}
+
+/*! Stops tracing and writes the trace to the scratch device, keeping the
+    newest entries if it cannot hold them all.  Does nothing if tracing is
+    off or there is no scratch device. */
+void blktrace_dump(void) {
+    struct block *scratch = block_get_role(BLOCK_SCRATCH);
+    struct blktrace_entry *entries = ring;
+    struct blktrace_header *h;
+    uint32_t cnt, max_cnt, i;
+    block_sector_t sec_no;
+    struct block *b;
+    uint8_t *buf;
+    size_t ofs;
+
+    ASSERT(sizeof *h <= BLOCK_SECTOR_SIZE);
+
+    if (entries == NULL || scratch == NULL || block_size(scratch) < 2)
+        return;
+
+    /* Stop first, so that the dump does not trace itself. */
+    ring = NULL;
+
+    buf = palloc_get_page(PAL_ZERO);
+    if (buf == NULL) {
+        printf("blktrace: out of memory\n");
+        return;
+    }
+
+    cnt = recorded < RING_CNT ? recorded : RING_CNT;
+    max_cnt = (block_size(scratch) - 1) * BLOCK_SECTOR_SIZE / sizeof *entries;
+    if (cnt > max_cnt)
+        cnt = max_cnt;
+
+    h = (struct blktrace_header *) buf;
+    memcpy(h->magic, BLKTRACE_MAGIC, sizeof h->magic);
+    h->version = BLKTRACE_VERSION;
+    h->entry_cnt = cnt;
+    h->lost = recorded - cnt;
+    for (b = block_first(); b != NULL && h->dev_cnt < BLKTRACE_MAX_DEVS;
+         b = block_next(b)) {
+        struct blktrace_dev *d = &h->devs[h->dev_cnt++];
+        strlcpy(d->name, block_name(b), sizeof d->name);
+        d->type = block_type(b);
+        d->size = block_size(b);
+    }
+    block_write(scratch, 0, buf);
+
+    /* Pack the entries into the following sectors, oldest first.  An
+       entry may straddle two sectors. */
+    memset(buf, 0, BLOCK_SECTOR_SIZE);
+    sec_no = 1;
+    ofs = 0;
+    for (i = recorded - cnt; i != recorded; i++) {
+        const uint8_t *src = (const uint8_t *) &entries[i % RING_CNT];
+        size_t left = sizeof *entries;
+
+        while (left > 0) {
+            size_t chunk = BLOCK_SECTOR_SIZE - ofs;
+            if (chunk > left)
+                chunk = left;
+            memcpy(buf + ofs, src, chunk);
+            src += chunk;
+            left -= chunk;
+            ofs += chunk;
+            if (ofs == BLOCK_SECTOR_SIZE) {
+                block_write(scratch, sec_no++, buf);
+                ofs = 0;
+            }
+        }
+    }
+    if (ofs > 0) {
+        memset(buf + ofs, 0, BLOCK_SECTOR_SIZE - ofs);
+        block_write(scratch, sec_no, buf);
+    }
+
+    printf("blktrace: wrote %"PRIu32" entries to %s, %"PRIu32" lost\n",
+           cnt, block_name(scratch), recorded - cnt);
+    palloc_free_page(buf);
+    palloc_free_multiple(entries, RING_PAGES);
+}
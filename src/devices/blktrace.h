@@ -0,0 +1,14 @@
+#ifndef DEVICES_BLKTRACE_H
+#define DEVICES_BLKTRACE_H
+
+#include <stdbool.h>
+
+struct block;
+struct block_request;
+
+void blktrace_start(void);
+void blktrace_record(struct block *, const struct block_request *,
+                     bool sync);
+void blktrace_dump(void);
+
+#endif /* devices/blktrace.h */
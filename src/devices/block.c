@@ -2,8 +2,16 @@
 #include <list.h>
 #include <string.h>
 #include <stdio.h>
+#include "devices/blktrace.h"
 #include "devices/ide.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/*! Most sectors the dispatcher merges into one transfer. */
+#define BLOCK_MERGE_MAX 32
 
 /*! List of all block devices. */
 static struct list all_blocks = LIST_INITIALIZER(all_blocks);
@@ -12,6 +20,9 @@ static struct list all_blocks = LIST_INITIALIZER(all_blocks);
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
 static struct block *list_elem_to_block(struct list_elem *);
+static void submit_wait(struct block *, bool write, block_sector_t,
+                        void *buffer, size_t cnt);
+static void wake_waiter(struct block_request *);
 
 /*! Returns a human-readable name for the given block device TYPE. */
 const char * block_type_name(enum block_type type) {
@@ -78,14 +89,25 @@ static void check_sector(struct block *block, block_sector_t sector) {
     }
 }
 
+/*! Verifies that the CNT sectors starting at SECTOR all lie within BLOCK.
+    Panics if not. */
+static void check_sectors(struct block *block, block_sector_t sector,
+                          size_t cnt) {
+    ASSERT(cnt > 0);
+    check_sector(block, sector);
+    if (cnt > block->size - sector) {
+        PANIC("Access past end of device %s (sector=%"PRDSNu", cnt=%zu, "
+              "size=%"PRDSNu")\n", block_name(block), sector, cnt,
+              block->size);
+    }
+}
+
 /*! Reads sector SECTOR from BLOCK into BUFFER, which must
     have room for BLOCK_SECTOR_SIZE bytes.
     Internally synchronizes accesses to block devices, so external
     per-block device locking is unneeded. */
 void block_read(struct block *block, block_sector_t sector, void *buffer) {
-    check_sector(block, sector);
-    block->ops->read(block->aux, sector, buffer);
-    block->read_cnt++;
+    submit_wait(block, false, sector, buffer, 1);
 }
 
 /*! Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -95,10 +117,24 @@ void block_read(struct block *block, block_sector_t sector, void *buffer) {
     per-block device locking is unneeded. */
 void block_write(struct block *block, block_sector_t sector,
                  const void *buffer) {
-    check_sector(block, sector);
-    ASSERT(block->type != BLOCK_FOREIGN);
-    block->ops->write(block->aux, sector, buffer);
-    block->write_cnt++;
+    submit_wait(block, true, sector, (void *) buffer, 1);
+}
+
+/*! Reads CNT consecutive sectors starting at SECTOR from BLOCK into
+    BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE bytes.
+    Drivers that can move several sectors per command do so; others are
+    called once per sector. */
+void block_read_multiple(struct block *block, block_sector_t sector,
+                         void *buffer, size_t cnt) {
+    submit_wait(block, false, sector, buffer, cnt);
+}
+
+/*! Writes CNT consecutive sectors starting at SECTOR to BLOCK from
+    BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.  Returns
+    after the block device has acknowledged receiving all of the data. */
+void block_write_multiple(struct block *block, block_sector_t sector,
+                          const void *buffer, size_t cnt) {
+    submit_wait(block, true, sector, (void *) buffer, cnt);
 }
 
 /*! Returns the number of sectors in BLOCK. */
@@ -116,20 +152,70 @@ enum block_type block_type(struct block *block) {
     return block->type;
 }
 
-/*! Prints statistics for each block device used for a Pintos role. */
+/*! Prints the statistics in STATS for transfers in direction DIR. */
+static void print_dir_stats(const char *dir, const struct blkstat_dir *stats) {
+    int i, last;
+
+    if (stats->ops == 0)
+        return;
+    printf("  %s: %"PRIu64" ops, %"PRIu64" kB, %"PRIu64"%% sequential, "
+           "avg %"PRIu64" us, max %"PRIu64" us\n", dir, stats->ops,
+           stats->bytes / 1024, stats->sequential * 100 / stats->ops,
+           stats->total_us / stats->ops, stats->max_us);
+
+    for (last = BLKSTAT_BUCKETS - 1; stats->hist[last] == 0; last--)
+        continue;
+    printf("  %s latency (us):", dir);
+    for (i = 0; i <= last; i++)
+        printf(" <%u:%"PRIu32, 2u << i, stats->hist[i]);
+    printf("\n");
+}
+
+/*! Prints statistics for each block device used for a Pintos role, and for
+    each other device that has seen any I/O. */
 void block_print_stats(void) {
-    int i;
-
-    for (i = 0; i < BLOCK_ROLE_CNT; i++) {
-        struct block *block = block_by_role[i];
-        if (block != NULL) {
-            printf("%s (%s): %llu reads, %llu writes\n",
-                   block->name, block_type_name(block->type),
-                   block->read_cnt, block->write_cnt);
-        }
+    struct list_elem *e;
+
+    for (e = list_begin(&all_blocks); e != list_end(&all_blocks);
+         e = list_next(e)) {
+        struct block *block = list_entry(e, struct block, list_elem);
+        if (block->type >= BLOCK_ROLE_CNT
+            && block->read_cnt + block->write_cnt == 0)
+            continue;
+
+        printf("%s (%s): %llu reads, %llu writes\n",
+               block->name, block_type_name(block->type),
+               block->read_cnt, block->write_cnt);
+        print_dir_stats("reads", &block->stats[BLKSTAT_READ]);
+        print_dir_stats("writes", &block->stats[BLKSTAT_WRITE]);
+        if (block->submits > 0)
+            printf("  queue depth: avg %"PRIu64", max %"PRIu32"\n",
+                   block->depth_sum / block->submits, block->max_depth);
     }
 }
 
+/*! Copies the statistics of the block device at position INDEX in kernel
+    probe order into *STATS.  Returns false if there is no such device. */
+bool block_get_stats(unsigned index, struct blkstat *stats) {
+    struct block *block;
+
+    for (block = block_first(); block != NULL && index > 0;
+         block = block_next(block))
+        index--;
+    if (block == NULL)
+        return false;
+
+    memset(stats, 0, sizeof *stats);
+    strlcpy(stats->name, block->name, sizeof stats->name);
+    strlcpy(stats->role, block_type_name(block->type), sizeof stats->role);
+    stats->size = block->size;
+    stats->max_depth = block->max_depth;
+    stats->depth_sum = block->depth_sum;
+    stats->submits = block->submits;
+    memcpy(stats->dir, block->stats, sizeof stats->dir);
+    return true;
+}
+
 /*! Registers a new block device with the given NAME.  If EXTRA_INFO is
     non-null, it is printed as part of a user message.  The block device's
     SIZE in sectors and its TYPE must be provided, as well as the it operation
@@ -149,6 +235,20 @@ struct block * block_register(const char *name, enum block_type type,
     block->aux = aux;
     block->read_cnt = 0;
     block->write_cnt = 0;
+    lock_init_named(&block->queue_lock, "block queue");
+    cond_init(&block->queue_ready);
+    cond_init(&block->queue_idle);
+    list_init(&block->queue);
+    block->queue_started = false;
+    block->queue_busy = false;
+    block->queue_head = 0;
+    block->queue_seq = 0;
+    block->bounce = NULL;
+    memset(block->stats, 0, sizeof block->stats);
+    block->last_end = 0;
+    block->max_depth = 0;
+    block->depth_sum = 0;
+    block->submits = 0;
 
     printf("%s: %'"PRDSNu" sectors (", block->name, block->size);
     print_human_readable_size((uint64_t) block->size * BLOCK_SECTOR_SIZE);
@@ -167,3 +267,302 @@ static struct block * list_elem_to_block(struct list_elem *list_elem) {
             list_entry(list_elem, struct block, list_elem) : NULL);
 }
 
+
+/* Request queues.
+
+   Every transfer goes through the queue of the device that finally
+   performs it, including the synchronous ones above, which simply wait
+   for their request to complete.  A dispatcher thread per device serves
+   the queue in C-LOOK order: it sweeps upward from the last sector it
+   transferred and jumps back to the lowest pending sector at the top.
+   Pending requests in the same direction that are adjacent on disk are
+   merged into a single driver call.
+
+   A request never passes an earlier request that overlaps it, so a read
+   always sees the data of every write submitted before it. */
+
+static void dispatcher(void *block_);
+
+/*! Initializes request R to read or write, as WRITE says, the CNT sectors
+    starting at SECTOR, to or from BUFFER.  COMPLETE, if non-null, is
+    called with R when the transfer is done; AUX is stored in R for its
+    use. */
+void block_request_init(struct block_request *r, bool write,
+                        block_sector_t sector, void *buffer, size_t cnt,
+                        void (*complete)(struct block_request *),
+                        void *aux) {
+    r->write = write;
+    r->sector = sector;
+    r->buffer = buffer;
+    r->cnt = cnt;
+    r->complete = complete;
+    r->aux = aux;
+    r->origin = NULL;
+}
+
+static bool request_less(const struct list_elem *a_,
+                         const struct list_elem *b_, void *aux UNUSED) {
+    const struct block_request *a = list_entry(a_, struct block_request,
+                                               elem);
+    const struct block_request *b = list_entry(b_, struct block_request,
+                                               elem);
+    return a->sector < b->sector || (a->sector == b->sector && a->seq < b->seq);
+}
+
+/*! Queues request R on BLOCK and returns at once.  R's sector may be
+    translated on the way to the device that serves it. */
+void block_submit(struct block *block, struct block_request *r) {
+    size_t depth;
+
+    check_sectors(block, r->sector, r->cnt);
+    if (r->write) {
+        ASSERT(block->type != BLOCK_FOREIGN);
+        block->write_cnt += r->cnt;
+    }
+    else
+        block->read_cnt += r->cnt;
+
+    /* Latency is measured from the first submission, so that it covers
+       time spent in every queue on the way. */
+    if (r->origin == NULL) {
+        r->origin = block;
+        r->start = timer_cycles();
+        blktrace_record(block, r, r->complete == wake_waiter);
+    }
+    if (r->sector == block->last_end)
+        block->stats[r->write].sequential++;
+    block->last_end = r->sector + r->cnt;
+
+    if (block->ops->submit != NULL) {
+        block->ops->submit(block->aux, r);
+        return;
+    }
+
+    lock_acquire(&block->queue_lock);
+    if (!block->queue_started) {
+        block->queue_started = true;
+        thread_create(block->name, PRI_MAX, dispatcher, block);
+    }
+    r->seq = block->queue_seq++;
+    list_insert_ordered(&block->queue, &r->elem, request_less, NULL);
+    depth = list_size(&block->queue) + (block->queue_busy ? 1 : 0);
+    block->submits++;
+    block->depth_sum += depth;
+    if (depth > block->max_depth)
+        block->max_depth = depth;
+    cond_signal(&block->queue_ready, &block->queue_lock);
+    lock_release(&block->queue_lock);
+}
+
+/*! Waits until every request submitted so far to any device has
+    completed. */
+void block_drain(void) {
+    struct list_elem *e;
+
+    for (e = list_begin(&all_blocks); e != list_end(&all_blocks);
+         e = list_next(e)) {
+        struct block *block = list_entry(e, struct block, list_elem);
+
+        lock_acquire(&block->queue_lock);
+        while (!list_empty(&block->queue) || block->queue_busy)
+            cond_wait(&block->queue_idle, &block->queue_lock);
+        lock_release(&block->queue_lock);
+    }
+}
+
+/*! Completion callback for submit_wait(). */
+static void wake_waiter(struct block_request *r) {
+    sema_up(r->aux);
+}
+
+/*! Submits a transfer of CNT sectors to BLOCK and waits for it. */
+static void submit_wait(struct block *block, bool write,
+                        block_sector_t sector, void *buffer, size_t cnt) {
+    struct block_request r;
+    struct semaphore done;
+
+    sema_init(&done, 0);
+    block_request_init(&r, write, sector, buffer, cnt, wake_waiter, &done);
+    block_submit(block, &r);
+    sema_down(&done);
+}
+
+/*! Returns true if R may be dispatched from BLOCK's queue, that is, if no
+    earlier pending request overlaps it.  The caller must hold the queue
+    lock. */
+static bool request_ready(struct block *block, struct block_request *r) {
+    struct list_elem *e;
+
+    for (e = list_begin(&block->queue); e != list_end(&block->queue);
+         e = list_next(e)) {
+        struct block_request *q = list_entry(e, struct block_request, elem);
+        if (q->seq < r->seq && q->sector < r->sector + r->cnt &&
+            r->sector < q->sector + q->cnt)
+            return false;
+    }
+    return true;
+}
+
+/*! Returns the next request to serve from BLOCK's nonempty queue in C-LOOK
+    order.  The caller must hold the queue lock. */
+static struct block_request *next_request(struct block *block) {
+    struct block_request *first = NULL;
+    struct list_elem *e;
+
+    for (e = list_begin(&block->queue); e != list_end(&block->queue);
+         e = list_next(e)) {
+        struct block_request *r = list_entry(e, struct block_request, elem);
+        if (!request_ready(block, r))
+            continue;
+        if (r->sector >= block->queue_head)
+            return r;
+        if (first == NULL)
+            first = r;
+    }
+
+    /* The oldest request is always ready, so there is a candidate. */
+    ASSERT(first != NULL);
+    return first;
+}
+
+/*! Moves CNT sectors between BLOCK, starting at SECTOR, and BUFFER, using
+    the driver directly. */
+static void transfer(struct block *block, bool write, block_sector_t sector,
+                     uint8_t *buffer, size_t cnt) {
+    size_t i;
+
+    if (write && block->ops->write_multiple != NULL)
+        block->ops->write_multiple(block->aux, sector, buffer, cnt);
+    else if (!write && block->ops->read_multiple != NULL)
+        block->ops->read_multiple(block->aux, sector, buffer, cnt);
+    else {
+        for (i = 0; i < cnt; i++, buffer += BLOCK_SECTOR_SIZE) {
+            if (write)
+                block->ops->write(block->aux, sector + i, buffer);
+            else
+                block->ops->read(block->aux, sector + i, buffer);
+        }
+    }
+}
+
+/*! Adds finished request R, which took US microseconds, to BLOCK's
+    statistics. */
+static void account_request(struct block *block,
+                            const struct block_request *r, uint64_t us) {
+    struct blkstat_dir *stats = &block->stats[r->write];
+    int bucket;
+
+    stats->ops++;
+    stats->bytes += r->cnt * BLOCK_SECTOR_SIZE;
+    stats->total_us += us;
+    if (us > stats->max_us)
+        stats->max_us = us;
+    for (bucket = 0; us >= 2 && bucket < BLKSTAT_BUCKETS - 1; bucket++)
+        us >>= 1;
+    stats->hist[bucket]++;
+}
+
+/*! Finishes request R, which BLOCK has just carried out: charges it to the
+    statistics and calls its completion callback.  The dispatcher calls
+    this, as must drivers whose submit operation carries out requests
+    itself. */
+void block_complete(struct block *block, struct block_request *r) {
+    uint64_t us = timer_cycles_to_us(timer_cycles() - r->start);
+
+    account_request(block, r, us);
+    if (r->origin != block)
+        account_request(r->origin, r, us);
+    if (r->complete != NULL)
+        r->complete(r);
+}
+
+/*! Removes from BLOCK's queue the next request and any that can be merged
+    with it, and appends them to RUN in sector order.  Returns the total
+    number of sectors.  The caller must hold the queue lock. */
+static size_t take_run(struct block *block, struct list *run) {
+    struct block_request *r = next_request(block);
+    size_t cnt = r->cnt;
+    struct list_elem *e = list_next(&r->elem);
+
+    list_remove(&r->elem);
+    list_push_back(run, &r->elem);
+
+    while (block->bounce != NULL && e != list_end(&block->queue)) {
+        struct block_request *q = list_entry(e, struct block_request, elem);
+
+        if (q->write != r->write || q->sector != r->sector + r->cnt ||
+            cnt + q->cnt > BLOCK_MERGE_MAX || !request_ready(block, q))
+            break;
+        e = list_next(e);
+        list_remove(&q->elem);
+        list_push_back(run, &q->elem);
+        cnt += q->cnt;
+        r = q;
+    }
+    return cnt;
+}
+
+/*! Main function for a device's dispatcher thread. */
+static void dispatcher(void *block_) {
+    struct block *block = block_;
+    struct list run;
+
+    /* Without a bounce buffer, requests are simply not merged. */
+    block->bounce = palloc_get_multiple(0, BLOCK_MERGE_MAX
+                                           * BLOCK_SECTOR_SIZE / PGSIZE);
+    list_init(&run);
+
+    while (true) {
+        struct block_request *first, *r;
+        struct list_elem *e;
+        block_sector_t end;
+        uint8_t *p;
+        size_t cnt;
+
+        lock_acquire(&block->queue_lock);
+        while (list_empty(&block->queue))
+            cond_wait(&block->queue_ready, &block->queue_lock);
+        cnt = take_run(block, &run);
+        block->queue_busy = true;
+        lock_release(&block->queue_lock);
+
+        first = list_entry(list_front(&run), struct block_request, elem);
+        end = first->sector + cnt;
+        if (list_size(&run) == 1)
+            transfer(block, first->write, first->sector, first->buffer, cnt);
+        else {
+            /* Gather writes into the bounce buffer, or scatter reads out
+               of it. */
+            if (first->write) {
+                for (p = block->bounce, e = list_begin(&run);
+                     e != list_end(&run); e = list_next(e)) {
+                    r = list_entry(e, struct block_request, elem);
+                    memcpy(p, r->buffer, r->cnt * BLOCK_SECTOR_SIZE);
+                    p += r->cnt * BLOCK_SECTOR_SIZE;
+                }
+            }
+            transfer(block, first->write, first->sector, block->bounce, cnt);
+            if (!first->write) {
+                for (p = block->bounce, e = list_begin(&run);
+                     e != list_end(&run); e = list_next(e)) {
+                    r = list_entry(e, struct block_request, elem);
+                    memcpy(r->buffer, p, r->cnt * BLOCK_SECTOR_SIZE);
+                    p += r->cnt * BLOCK_SECTOR_SIZE;
+                }
+            }
+        }
+
+        /* A callback may free or reuse its request, so unlink it first. */
+        while (!list_empty(&run)) {
+            r = list_entry(list_pop_front(&run), struct block_request, elem);
+            block_complete(block, r);
+        }
+
+        lock_acquire(&block->queue_lock);
+        block->queue_head = end;
+        block->queue_busy = false;
+        if (list_empty(&block->queue))
+            cond_broadcast(&block->queue_idle, &block->queue_lock);
+        lock_release(&block->queue_lock);
+    }
+}
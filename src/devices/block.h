@@ -1,9 +1,11 @@
 #ifndef DEVICES_BLOCK_H
 #define DEVICES_BLOCK_H
 
+#include <blkstat.h>
 #include <stddef.h>
 #include <inttypes.h>
 #include <list.h>
+#include "threads/synch.h"
 
 /*! Size of a block device sector in bytes.  All IDE disks use this sector
     size, as do most USB and SCSI disks.  It's not worth it to try to cater
@@ -50,6 +52,44 @@ struct block {
 
     unsigned long long read_cnt;        /*!< Number of sectors read. */
     unsigned long long write_cnt;       /*!< Number of sectors written. */
+
+    /*! Detailed statistics, reported by block_get_stats(). @{ */
+    struct blkstat_dir stats[BLKSTAT_DIRS];     /*!< By direction. */
+    block_sector_t last_end;            /*!< Sector after last request. */
+    uint32_t max_depth;                 /*!< Deepest the queue has been. */
+    uint64_t depth_sum;                 /*!< Sum of depths at submission. */
+    uint64_t submits;                   /*!< Submissions to the queue. */
+    /*! @} */
+
+    /*! Request queue, for devices whose driver has no submit operation.
+        @{ */
+    struct lock queue_lock;             /*!< Protects the members below. */
+    struct condition queue_ready;       /*!< Signalled on submission. */
+    struct condition queue_idle;        /*!< Signalled when queue drains. */
+    struct list queue;                  /*!< Pending requests, by sector. */
+    bool queue_started;                 /*!< Dispatcher thread created? */
+    bool queue_busy;                    /*!< Transfer in progress? */
+    block_sector_t queue_head;          /*!< Sector after last transfer. */
+    unsigned queue_seq;                 /*!< Next submission number. */
+    uint8_t *bounce;                    /*!< Buffer for merged transfers. */
+    /*! @} */
+};
+
+/*! An asynchronous transfer of CNT consecutive sectors.  The submitter
+    owns the request and its buffer until COMPLETE is called.  COMPLETE
+    runs in the device's dispatcher thread, so it must not wait for other
+    requests, nor for locks whose holders might. */
+struct block_request {
+    struct list_elem elem;              /*!< Element in a device queue. */
+    bool write;                         /*!< Write, rather than read? */
+    block_sector_t sector;              /*!< First sector. */
+    void *buffer;                       /*!< CNT * BLOCK_SECTOR_SIZE bytes. */
+    size_t cnt;                         /*!< Number of sectors. */
+    void (*complete)(struct block_request *);   /*!< Callback, or NULL. */
+    void *aux;                          /*!< For use by COMPLETE. */
+    unsigned seq;                       /*!< Submission number. */
+    struct block *origin;               /*!< Device first submitted to. */
+    uint64_t start;                     /*!< Time-stamp at submission. */
 };
 
 const char *block_type_name(enum block_type);
@@ -66,22 +106,47 @@ struct block *block_next(struct block *);
 block_sector_t block_size(struct block *);
 void block_read(struct block *, block_sector_t, void *);
 void block_write(struct block *, block_sector_t, const void *);
+void block_read_multiple(struct block *, block_sector_t, void *, size_t cnt);
+void block_write_multiple(struct block *, block_sector_t, const void *,
+                          size_t cnt);
 const char *block_name(struct block *);
 enum block_type block_type(struct block *);
 
+/* Asynchronous requests. */
+void block_request_init(struct block_request *, bool write,
+                        block_sector_t, void *buffer, size_t cnt,
+                        void (*complete)(struct block_request *), void *aux);
+void block_submit(struct block *, struct block_request *);
+void block_drain(void);
+
 /* Statistics. */
 void block_print_stats(void);
+bool block_get_stats(unsigned index, struct blkstat *);
 
 /* Lower-level interface to block device drivers. */
 
 struct block_operations {
     void (*read)(void *aux, block_sector_t, void *buffer);
     void (*write)(void *aux, block_sector_t, const void *buffer);
+
+    /*! Optional transfers of CNT consecutive sectors.  Drivers that leave
+        these null get one read() or write() call per sector. */
+    void (*read_multiple)(void *aux, block_sector_t, void *buffer,
+                          size_t cnt);
+    void (*write_multiple)(void *aux, block_sector_t, const void *buffer,
+                           size_t cnt);
+
+    /*! Optional.  Takes over request R, which is for this device, instead
+        of queuing it here.  Partitions use it to pass requests down to
+        their disk's queue.  A driver that carries out R itself must then
+        call block_complete(). */
+    void (*submit)(void *aux, struct block_request *r);
 };
 
 struct block *block_register(const char *name, enum block_type,
                              const char *extra_info, block_sector_t size,
                              const struct block_operations *, void *aux);
+void block_complete(struct block *, struct block_request *);
 
 #endif /* devices/block.h */
 
@@ -1,19 +1,28 @@
 /*! \file ide.c
 
    The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].
+
+   If the controller is a PCI IDE controller with bus-master DMA, such as
+   the PIIX that QEMU and Bochs emulate, disks that support it move data by
+   DMA instead of through the data register, and the CPU is free while the
+   transfer runs.  Anything DMA cannot handle falls back to PIO. */
 
 #include "devices/ide.h"
 #include <ctype.h>
 #include <debug.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/block.h"
 #include "devices/partition.h"
+#include "devices/pci.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /*! ATA command block port addresses. @{ */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)    /*!< Data. */
@@ -38,6 +47,7 @@
 #define STA_BSY 0x80            /*!< Busy. */
 #define STA_DRDY 0x40           /*!< Device Ready. */
 #define STA_DRQ 0x08            /*!< Data Request. */
+#define STA_ERR 0x01            /*!< Error. */
 /*! @} */
 
 /*! Control Register bits. @{ */
@@ -55,14 +65,69 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /*!< IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /*!< READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /*!< WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /*!< READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /*!< WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /*!< SET MULTIPLE MODE. */
+#define CMD_READ_DMA 0xc8               /*!< READ DMA. */
+#define CMD_WRITE_DMA 0xca              /*!< WRITE DMA. */
+/*! @} */
+
+/*! Bus-master DMA port addresses, relative to the channel's bus-master
+    base.  See [IDE-BM]. @{ */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0) /*!< Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)  /*!< Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)    /*!< PRD table. */
+/*! @} */
+
+/*! Bus-master Command Register bits. @{ */
+#define BM_CMD_START 0x01       /*!< Start/stop the transfer. */
+#define BM_CMD_READ 0x08        /*!< Direction: 1=disk to memory. */
+/*! @} */
+
+/*! Bus-master Status Register bits.  ERR and IRQ are cleared by writing
+    1s to them; the other bits must be written back unchanged. @{ */
+#define BM_STA_ERR 0x02         /*!< Transfer failed. */
+#define BM_STA_IRQ 0x04         /*!< Disk raised its interrupt. */
 /*! @} */
 
+/*! A Physical Region Descriptor, which points the bus-master engine at one
+    physically contiguous piece of a transfer.  A piece may not cross a 64
+    kB boundary, and a byte count of 0 stands for 64 kB. */
+struct prd {
+    uint32_t addr;              /*!< Physical address, even. */
+    uint16_t size;              /*!< Byte count, even. */
+    uint16_t flags;             /*!< PRD_EOT on the last descriptor. */
+};
+
+#define PRD_EOT 0x8000          /*!< End of table. */
+#define PRD_CNT (PGSIZE / sizeof (struct prd))  /*!< Descriptors per table. */
+
+/*! Number of times to poll a status register before falling back to
+    sleeping a timer tick between polls.  A port read takes on the order of
+    a microsecond, and a disk that is working on a command usually finishes
+    well within this many. */
+#define SPIN_POLLS 1000
+
+/*! Most sectors a single READ or WRITE command can move.  A sector count
+    register value of 0 stands for this many. */
+#define MAX_SECTORS_PER_CMD 256
+
 /*! An ATA device. */
 struct ata_disk {
     char name[8];               /*!< Name, e.g. "hda". */
     struct channel *channel;    /*!< Channel that disk is attached to. */
     int dev_no;                 /*!< Device 0 or 1 for master or slave. */
     bool is_ata;                /*!< Is device an ATA disk? */
+    int multiple;               /*!< Sectors per interrupt in READ/WRITE
+                                     MULTIPLE, or 0 if not enabled. */
+    bool dma;                   /*!< Use bus-master DMA? */
+};
+
+/*! Latency statistics for one kind of command. */
+struct ide_op_stats {
+    unsigned long long cnt;     /*!< Commands completed. */
+    uint64_t cycles;            /*!< Total time-stamp cycles they took. */
+    uint64_t max_cycles;        /*!< Cycles of the slowest one. */
 };
 
 /*! An ATA channel (aka controller).
@@ -77,6 +142,14 @@ struct channel {
                                      any interrupt would be spurious. */
     struct semaphore completion_wait;   /*!< Up'd by interrupt handler. */
 
+    uint16_t bm_base;           /*!< Bus-master base port, 0 if none. */
+    struct prd *prdt;           /*!< PRD table, one page from palloc. */
+
+    int selected;               /*!< Selected device, or -1 if unknown. */
+    struct ide_op_stats reads;  /*!< Read command latencies. */
+    struct ide_op_stats writes; /*!< Write command latencies. */
+    unsigned long long slow_waits;  /*!< Waits that outlasted SPIN_POLLS. */
+
     struct ata_disk devices[2];     /*!< The devices on this channel. */
 };
 
@@ -90,10 +163,15 @@ static void reset_channel(struct channel *);
 static bool check_device_type(struct ata_disk *);
 static void identify_ata_device(struct ata_disk *);
 
-static void select_sector(struct ata_disk *, block_sector_t);
+static void set_multiple_mode(struct ata_disk *, int sectors);
+static void select_sector(struct ata_disk *, block_sector_t, size_t cnt);
 static void issue_pio_command(struct channel *, uint8_t command);
-static void input_sector(struct channel *, void *);
-static void output_sector(struct channel *, const void *);
+static void input_sectors(struct channel *, void *, size_t cnt);
+static void output_sectors(struct channel *, const void *, size_t cnt);
+
+static void find_bus_master(struct channel *, size_t chan_no);
+static bool dma_transfer(struct ata_disk *, block_sector_t, void *,
+                         size_t cnt, bool writing);
 
 static void wait_until_idle(const struct ata_disk *);
 static bool wait_while_busy(const struct ata_disk *);
@@ -124,9 +202,13 @@ void ide_init (void) {
         default:
             NOT_REACHED();
         }
-        lock_init(&c->lock);
+        lock_init_named(&c->lock, "ide channel");
         c->expecting_interrupt = false;
         sema_init(&c->completion_wait, 0);
+        find_bus_master(c, chan_no);
+        c->selected = -1;
+        c->reads = c->writes = (struct ide_op_stats) {0, 0, 0};
+        c->slow_waits = 0;
  
         /* Initialize devices. */
         for (dev_no = 0; dev_no < 2; dev_no++) {
@@ -136,6 +218,8 @@ void ide_init (void) {
             d->channel = c;
             d->dev_no = dev_no;
             d->is_ata = false;
+            d->multiple = 0;
+            d->dma = false;
         }
 
         /* Register interrupt handler. */
@@ -193,6 +277,7 @@ static void reset_channel(struct channel *c) {
     outb(reg_ctl(c), CTL_SRST);
     timer_usleep(10);
     outb(reg_ctl(c), 0);
+    c->selected = -1;
 
     timer_msleep(150);
 
@@ -264,7 +349,7 @@ static void identify_ata_device(struct ata_disk *d) {
         d->is_ata = false;
         return;
     }
-    input_sector(c, id);
+    input_sectors(c, id, 1);
 
     /* Calculate capacity.  Read model name and serial number. */
     capacity = *(uint32_t *) &id[60 * 2];
@@ -285,6 +370,16 @@ static void identify_ata_device(struct ata_disk *d) {
         return;
     }
 
+    /* Word 47 gives the largest number of sectors the disk will move per
+       interrupt under READ/WRITE MULTIPLE, if it supports them at all. */
+    if ((id[47 * 2] & 0xff) > 1)
+        set_multiple_mode(d, id[47 * 2] & 0xff);
+
+    /* Bit 8 of word 49 says whether the disk can do DMA. */
+    d->dma = c->bm_base != 0 && (id[49 * 2 + 1] & 0x01) != 0;
+    if (d->dma)
+        strlcat(extra_info, ", DMA", sizeof extra_info);
+
     /* Register. */
     block = block_register(d->name, BLOCK_RAW, extra_info, capacity,
                          &ide_operations, d);
@@ -315,53 +410,199 @@ static char * descramble_ata_string(char *string, int size) {
     return string;
 }
 
-/*! Reads sector SEC_NO from disk D into BUFFER, which must have room for
-    BLOCK_SECTOR_SIZE bytes.  Internally synchronizes accesses to disks,
-    so external per-disk locking is unneeded. */
-static void ide_read(void *d_, block_sector_t sec_no, void *buffer) {
+/*! Reads CNT sectors, at most MAX_SECTORS_PER_CMD, starting at SEC_NO
+    from disk D into BUFFER with a single PIO command.  With READ MULTIPLE
+    the disk interrupts once per D->multiple sectors instead of once per
+    sector.  The caller must hold D's channel lock. */
+static void pio_read(struct ata_disk *d, block_sector_t sec_no,
+                     uint8_t *buffer, size_t cnt) {
+    struct channel *c = d->channel;
+    size_t per_irq = cnt > 1 && d->multiple > 1 ? d->multiple : 1;
+    size_t left = cnt;
+
+    select_sector(d, sec_no, cnt);
+    issue_pio_command(c, per_irq > 1 ? CMD_READ_MULTIPLE
+                                     : CMD_READ_SECTOR_RETRY);
+
+    /* The disk interrupts once each block of data is ready. */
+    while (left > 0) {
+        size_t n = left < per_irq ? left : per_irq;
+
+        sema_down(&c->completion_wait);
+        if (!wait_while_busy(d))
+            PANIC("%s: disk read failed, sector=%"PRDSNu,
+                  d->name, sec_no + (cnt - left));
+        input_sectors(c, buffer, n);
+        buffer += n * BLOCK_SECTOR_SIZE;
+        left -= n;
+    }
+}
+
+/*! Writes CNT sectors, at most MAX_SECTORS_PER_CMD, starting at SEC_NO to
+    disk D from BUFFER with a single PIO command, using WRITE MULTIPLE where
+    the disk supports it.  The caller must hold D's channel lock. */
+static void pio_write(struct ata_disk *d, block_sector_t sec_no,
+                      const uint8_t *buffer, size_t cnt) {
+    struct channel *c = d->channel;
+    size_t per_irq = cnt > 1 && d->multiple > 1 ? d->multiple : 1;
+    size_t left = cnt;
+
+    select_sector(d, sec_no, cnt);
+    issue_pio_command(c, per_irq > 1 ? CMD_WRITE_MULTIPLE
+                                     : CMD_WRITE_SECTOR_RETRY);
+
+    /* The disk asks for the first block without an interrupt, and
+       interrupts after taking each block, the last one included. */
+    while (left > 0) {
+        size_t n = left < per_irq ? left : per_irq;
+
+        if (!wait_while_busy(d))
+            PANIC("%s: disk write failed, sector=%"PRDSNu,
+                  d->name, sec_no + (cnt - left));
+        output_sectors(c, buffer, n);
+        sema_down(&c->completion_wait);
+        buffer += n * BLOCK_SECTOR_SIZE;
+        left -= n;
+    }
+}
+
+/*! Adds a command that started at time-stamp START and has just finished
+    to STATS.  The caller must hold the channel lock. */
+static void record_latency(struct ide_op_stats *stats, uint64_t start) {
+    uint64_t cycles = timer_cycles() - start;
+
+    stats->cnt++;
+    stats->cycles += cycles;
+    if (cycles > stats->max_cycles)
+        stats->max_cycles = cycles;
+}
+
+/*! Prints one line of STATS, for commands of the given KIND. */
+static void print_op_stats(const char *kind,
+                           const struct ide_op_stats *stats) {
+    printf(" %llu %s", stats->cnt, kind);
+    if (stats->cnt > 0)
+        printf(" (avg %"PRIu64" us, max %"PRIu64" us)",
+               timer_cycles_to_us(stats->cycles / stats->cnt),
+               timer_cycles_to_us(stats->max_cycles));
+}
+
+/*! Prints command latency statistics for each channel with a disk. */
+void ide_print_stats(void) {
+    struct channel *c;
+
+    for (c = channels; c < channels + CHANNEL_CNT; c++) {
+        if (!c->devices[0].is_ata && !c->devices[1].is_ata)
+            continue;
+        printf("%s:", c->name);
+        print_op_stats("reads", &c->reads);
+        printf(",");
+        print_op_stats("writes", &c->writes);
+        printf(", %llu slow waits\n", c->slow_waits);
+    }
+}
+
+/*! Reads CNT sectors starting at SEC_NO from disk D into BUFFER, which must
+    have room for CNT * BLOCK_SECTOR_SIZE bytes.  Runs of more than one
+    sector are moved with as few commands as the disk allows, by DMA if
+    possible and otherwise by PIO.  Internally synchronizes accesses to
+    disks, so external per-disk locking is unneeded. */
+static void ide_read_multiple(void *d_, block_sector_t sec_no, void *buffer,
+                              size_t cnt) {
     struct ata_disk *d = d_;
     struct channel *c = d->channel;
+    uint8_t *p = buffer;
+
     lock_acquire(&c->lock);
-    select_sector(d, sec_no);
-    issue_pio_command(c, CMD_READ_SECTOR_RETRY);
-    sema_down(&c->completion_wait);
-    if (!wait_while_busy(d))
-        PANIC("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-    input_sector(c, buffer);
+    while (cnt > 0) {
+        size_t cmd_cnt = cnt < MAX_SECTORS_PER_CMD ? cnt : MAX_SECTORS_PER_CMD;
+        uint64_t start = timer_cycles();
+
+        if (!d->dma || !dma_transfer(d, sec_no, p, cmd_cnt, false))
+            pio_read(d, sec_no, p, cmd_cnt);
+        record_latency(&c->reads, start);
+        p += cmd_cnt * BLOCK_SECTOR_SIZE;
+        sec_no += cmd_cnt;
+        cnt -= cmd_cnt;
+    }
     lock_release(&c->lock);
 }
 
-/*! Write sector SEC_NO to disk D from BUFFER, which must contain
-    BLOCK_SECTOR_SIZE bytes.  Returns after the disk has acknowledged
-    receiving the data.  Internally synchronizes accesses to disks, so external
-    per-disk locking is unneeded. */
-static void ide_write(void *d_, block_sector_t sec_no, const void *buffer) {
+/*! Writes CNT sectors starting at SEC_NO to disk D from BUFFER, which must
+    contain CNT * BLOCK_SECTOR_SIZE bytes, by DMA if possible and otherwise
+    by PIO.  Returns after the disk has acknowledged receiving the data.
+    Internally synchronizes accesses to disks, so external per-disk locking
+    is unneeded. */
+static void ide_write_multiple(void *d_, block_sector_t sec_no,
+                               const void *buffer, size_t cnt) {
     struct ata_disk *d = d_;
     struct channel *c = d->channel;
+    const uint8_t *p = buffer;
+
     lock_acquire(&c->lock);
-    select_sector(d, sec_no);
-    issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
-    if (!wait_while_busy(d))
-        PANIC("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-    output_sector(c, buffer);
-    sema_down(&c->completion_wait);
+    while (cnt > 0) {
+        size_t cmd_cnt = cnt < MAX_SECTORS_PER_CMD ? cnt : MAX_SECTORS_PER_CMD;
+        uint64_t start = timer_cycles();
+
+        /* The engine only reads from BUFFER when writing, so casting away
+           const is safe. */
+        if (!d->dma || !dma_transfer(d, sec_no, (void *) p, cmd_cnt, true))
+            pio_write(d, sec_no, p, cmd_cnt);
+        record_latency(&c->writes, start);
+        p += cmd_cnt * BLOCK_SECTOR_SIZE;
+        sec_no += cmd_cnt;
+        cnt -= cmd_cnt;
+    }
     lock_release(&c->lock);
 }
 
+/*! Reads sector SEC_NO from disk D into BUFFER, which must have room for
+    BLOCK_SECTOR_SIZE bytes. */
+static void ide_read(void *d_, block_sector_t sec_no, void *buffer) {
+    ide_read_multiple(d_, sec_no, buffer, 1);
+}
+
+/*! Write sector SEC_NO to disk D from BUFFER, which must contain
+    BLOCK_SECTOR_SIZE bytes.  Returns after the disk has acknowledged
+    receiving the data. */
+static void ide_write(void *d_, block_sector_t sec_no, const void *buffer) {
+    ide_write_multiple(d_, sec_no, buffer, 1);
+}
+
 static struct block_operations ide_operations = {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multiple,
+    ide_write_multiple,
+    NULL
 };
 
+/*! Asks disk D to move SECTORS sectors per interrupt in READ/WRITE
+    MULTIPLE and records the setting if the disk accepts it. */
+static void set_multiple_mode(struct ata_disk *d, int sectors) {
+    struct channel *c = d->channel;
+
+    select_device_wait(d);
+    outb(reg_nsect(c), sectors);
+    issue_pio_command(c, CMD_SET_MULTIPLE_MODE);
+    sema_down(&c->completion_wait);
+    wait_while_busy(d);
+    d->multiple = (inb(reg_status(c)) & STA_ERR) ? 0 : sectors;
+}
+
 /*! Selects device D, waiting for it to become ready, and then writes SEC_NO
-    to the disk's sector selection registers.  (We use LBA mode.) */
-static void select_sector(struct ata_disk *d, block_sector_t sec_no) {
+    and the sector count CNT, from 1 to MAX_SECTORS_PER_CMD, to the disk's
+    sector selection registers.  (We use LBA mode.) */
+static void select_sector(struct ata_disk *d, block_sector_t sec_no,
+                          size_t cnt) {
     struct channel *c = d->channel;
 
-    ASSERT(sec_no < (1UL << 28));
+    ASSERT(sec_no + cnt <= (1UL << 28));
+    ASSERT(cnt > 0 && cnt <= MAX_SECTORS_PER_CMD);
   
     select_device_wait(d);
-    outb(reg_nsect(c), 1);
+    /* A count of MAX_SECTORS_PER_CMD wraps to 0, as the disk expects. */
+    outb(reg_nsect(c), cnt);
     outb(reg_lbal(c), sec_no);
     outb(reg_lbam(c), sec_no >> 8);
     outb(reg_lbah(c), (sec_no >> 16));
@@ -380,32 +621,138 @@ static void issue_pio_command(struct channel *c, uint8_t command) {
     outb(reg_command(c), command);
 }
 
-/*! Reads a sector from channel C's data register in PIO mode into
-    SECTOR, which must have room for BLOCK_SECTOR_SIZE bytes. */
-static void input_sector(struct channel *c, void *sector) {
-    insw(reg_data(c), sector, BLOCK_SECTOR_SIZE / 2);
+/*! Reads CNT sectors from channel C's data register in PIO mode into
+    SECTORS, which must have room for CNT * BLOCK_SECTOR_SIZE bytes. */
+static void input_sectors(struct channel *c, void *sectors, size_t cnt) {
+    insw(reg_data(c), sectors, cnt * BLOCK_SECTOR_SIZE / 2);
 }
 
-/*! Writes SECTOR to channel C's data register in PIO mode.
-    SECTOR must contain BLOCK_SECTOR_SIZE bytes. */
-static void output_sector(struct channel *c, const void *sector) {
-    outsw(reg_data(c), sector, BLOCK_SECTOR_SIZE / 2);
+/*! Writes CNT sectors from SECTORS to channel C's data register in PIO
+    mode.  SECTORS must contain CNT * BLOCK_SECTOR_SIZE bytes. */
+static void output_sectors(struct channel *c, const void *sectors,
+                           size_t cnt) {
+    outsw(reg_data(c), sectors, cnt * BLOCK_SECTOR_SIZE / 2);
 }
 
+/* Bus-master DMA. */
+
+/*! Looks for a PCI IDE controller with bus-master DMA and, if there is
+    one, points channel C, number CHAN_NO, at its bus-master registers and
+    gives it a PRD table.  Otherwise C->bm_base is left 0, and C's disks
+    use PIO only. */
+static void find_bus_master(struct channel *c, size_t chan_no) {
+    struct pci_device p;
+    uint16_t base;
+
+    c->bm_base = 0;
+    c->prdt = NULL;
+
+    /* Class 1, sub-class 1 is an IDE controller.  Bit 7 of the
+       programming interface says it can be a bus master. */
+    if (!pci_find_class(0x01, 0x01, &p) || !(p.prog_if & 0x80))
+        return;
+    base = pci_io_bar(&p, 4);
+    if (base == 0)
+        return;
+
+    /* One page is always 4-byte aligned and never crosses 64 kB. */
+    c->prdt = palloc_get_page(0);
+    if (c->prdt == NULL)
+        return;
+    pci_enable_bus_master(&p);
+    c->bm_base = base + chan_no * 8;
+}
+
+/*! Fills in channel C's PRD table to cover the SIZE bytes at BUFFER.
+    Returns false if the engine cannot reach BUFFER. */
+static bool fill_prdt(struct channel *c, void *buffer, size_t size) {
+    uintptr_t paddr;
+    size_t i;
+
+    /* Kernel virtual memory maps physical memory one-to-one, so a kernel
+       buffer is physically contiguous.  The engine needs it even. */
+    if (!is_kernel_vaddr(buffer) || ((uintptr_t) buffer & 1) != 0)
+        return false;
+
+    paddr = vtop(buffer);
+    for (i = 0; size > 0; i++) {
+        size_t chunk = 0x10000 - (paddr & 0xffff);
+
+        if (i >= PRD_CNT)
+            return false;
+        if (chunk > size)
+            chunk = size;
+        c->prdt[i].addr = paddr;
+        c->prdt[i].size = chunk & 0xffff;
+        c->prdt[i].flags = 0;
+        paddr += chunk;
+        size -= chunk;
+    }
+    c->prdt[i - 1].flags = PRD_EOT;
+    return true;
+}
+
+/*! Moves CNT sectors, at most MAX_SECTORS_PER_CMD, between disk D, starting
+    at SEC_NO, and BUFFER by bus-master DMA, into BUFFER unless WRITING.  The
+    caller must hold D's channel lock.  The CPU is free until the single
+    interrupt that ends the transfer.  Returns true if successful.  Returns
+    false if the engine cannot reach BUFFER or the transfer failed, in which
+    case the caller should use PIO; a failure also turns DMA off for D. */
+static bool dma_transfer(struct ata_disk *d, block_sector_t sec_no,
+                         void *buffer, size_t cnt, bool writing) {
+    struct channel *c = d->channel;
+    uint8_t direction = writing ? 0 : BM_CMD_READ;
+    uint8_t bm_status, status;
+
+    if (!fill_prdt(c, buffer, cnt * BLOCK_SECTOR_SIZE))
+        return false;
+
+    select_sector(d, sec_no, cnt);
+    outl(reg_bm_prdt(c), vtop(c->prdt));
+    outb(reg_bm_status(c), inb(reg_bm_status(c)) | BM_STA_ERR | BM_STA_IRQ);
+    outb(reg_bm_command(c), direction);
+    issue_pio_command(c, writing ? CMD_WRITE_DMA : CMD_READ_DMA);
+    outb(reg_bm_command(c), direction | BM_CMD_START);
+
+    sema_down(&c->completion_wait);
+
+    outb(reg_bm_command(c), direction);
+    bm_status = inb(reg_bm_status(c));
+    outb(reg_bm_status(c), bm_status | BM_STA_ERR | BM_STA_IRQ);
+    status = inb(reg_alt_status(c));
+    if ((bm_status & BM_STA_ERR) != 0 ||
+        (status & (STA_BSY | STA_DRQ | STA_ERR)) != 0) {
+        printf("%s: DMA failed, sector=%"PRDSNu", using PIO\n",
+               d->name, sec_no);
+        d->dma = false;
+        return false;
+    }
+    return true;
+}
+
 /* Low-level ATA primitives. */
 
 /*! Wait up to 10 seconds for the controller to become idle, that
     is, for the BSY and DRQ bits to clear in the status register.
+    Polls without sleeping at first, since the controller is almost always
+    idle already, and only then sleeps a tick between polls.
 
     As a side effect, reading the status register clears any
     pending interrupt. */
 static void wait_until_idle(const struct ata_disk *d) {
+    struct channel *c = d->channel;
     int i;
 
+    for (i = 0; i < SPIN_POLLS; i++) {
+        if ((inb(reg_status(c)) & (STA_BSY | STA_DRQ)) == 0)
+            return;
+    }
+
+    c->slow_waits++;
     for (i = 0; i < 1000; i++) {
-        if ((inb(reg_status(d->channel)) & (STA_BSY | STA_DRQ)) == 0)
+        timer_msleep(10);
+        if ((inb(reg_status(c)) & (STA_BSY | STA_DRQ)) == 0)
             return;
-        timer_usleep(10);
     }
 
     printf("%s: idle timeout\n", d->name);
@@ -417,7 +764,15 @@ static void wait_until_idle(const struct ata_disk *d) {
 static bool wait_while_busy(const struct ata_disk *d) {
     struct channel *c = d->channel;
     int i;
-  
+
+    /* After a completion interrupt BSY is normally clear already, so a
+       short spin avoids sleeping a whole tick. */
+    for (i = 0; i < SPIN_POLLS; i++) {
+        if (!(inb(reg_alt_status(c)) & STA_BSY))
+            return (inb(reg_alt_status(c)) & STA_DRQ) != 0;
+    }
+
+    c->slow_waits++;
     for (i = 0; i < 3000; i++) {
         if (i == 700)
             printf("%s: busy, waiting...", d->name);
@@ -437,19 +792,28 @@ static bool wait_while_busy(const struct ata_disk *d) {
 static void select_device(const struct ata_disk *d) {
     struct channel *c = d->channel;
     uint8_t dev = DEV_MBS;
+    int i;
+
     if (d->dev_no == 1)
         dev |= DEV_DEV;
     outb(reg_device(c), dev);
-    inb(reg_alt_status(c));
-    timer_nsleep(400);
+    c->selected = d->dev_no;
+
+    /* The disk needs 400 ns to respond.  Each status read takes at least
+       100 ns, which is cheaper than a calibrated delay. */
+    for (i = 0; i < 4; i++)
+        inb(reg_alt_status(c));
 }
 
 /*! Select disk D in its channel, as select_device(), but wait for
-    the channel to become idle before and after. */
+    the channel to become idle before and after.  If D is selected
+    already, only waits for the channel to become idle. */
 static void select_device_wait(const struct ata_disk *d) {
     wait_until_idle(d);
-    select_device(d);
-    wait_until_idle(d);
+    if (d->channel->selected != d->dev_no) {
+        select_device(d);
+        wait_until_idle(d);
+    }
 }
 
 /*! ATA interrupt handler. */
@@ -32,7 +32,8 @@ intq_full (const struct intq *q)
 }
 
 /* Removes a byte from Q and returns it.
-   If Q is empty, sleeps until a byte is added.
+   If Q is empty, sleeps until a byte is added, or returns 0 if
+   the thread is interrupted by thread_interrupt().
    When called from an interrupt handler, Q must not be empty. */
 uint8_t
 intq_getc (struct intq *q) 
@@ -44,6 +45,11 @@ intq_getc (struct intq *q)
     {
       ASSERT (!intr_context ());
       lock_acquire (&q->lock);
+      if (thread_current ()->interrupted)
+        {
+          lock_release (&q->lock);
+          return 0;
+        }
       wait (q, &q->not_empty);
       lock_release (&q->lock);
     }
@@ -82,7 +88,8 @@ next (int pos)
 }
 
 /* WAITER must be the address of Q's not_empty or not_full
-   member.  Waits until the given condition is true. */
+   member.  Waits until the given condition is true, or until
+   the thread is interrupted by thread_interrupt(). */
 static void
 wait (struct intq *q UNUSED, struct thread **waiter) 
 {
@@ -92,13 +99,16 @@ wait (struct intq *q UNUSED, struct thread **waiter)
           || (waiter == &q->not_full && intq_full (q)));
 
   *waiter = thread_current ();
-  thread_block ();
+  thread_block_interruptible ();
+  if (*waiter == thread_current ())
+    *waiter = NULL;
 }
 
 /* WAITER must be the address of Q's not_empty or not_full
    member, and the associated condition must be true.  If a
    thread is waiting for the condition, wakes it up and resets
-   the waiting thread. */
+   the waiting thread.  A waiter already woken by
+   thread_interrupt() is not blocked, and resets itself. */
 static void
 signal (struct intq *q UNUSED, struct thread **waiter) 
 {
@@ -106,7 +116,7 @@ signal (struct intq *q UNUSED, struct thread **waiter)
   ASSERT ((waiter == &q->not_empty && !intq_empty (q))
           || (waiter == &q->not_full && !intq_full (q)));
 
-  if (*waiter != NULL) 
+  if (*waiter != NULL && (*waiter)->status == THREAD_BLOCKED) 
     {
       thread_unblock (*waiter);
       *waiter = NULL;
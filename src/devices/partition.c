@@ -296,8 +296,33 @@ static void partition_write(void *p_, block_sector_t sector,
     block_write(p->block, p->start + sector, buffer);
 }
 
+/*! Reads CNT sectors starting at SECTOR from partition P into BUFFER. */
+static void partition_read_multiple(void *p_, block_sector_t sector,
+                                    void *buffer, size_t cnt) {
+    struct partition *p = p_;
+    block_read_multiple(p->block, p->start + sector, buffer, cnt);
+}
+
+/*! Writes CNT sectors starting at SECTOR to partition P from BUFFER. */
+static void partition_write_multiple(void *p_, block_sector_t sector,
+                                     const void *buffer, size_t cnt) {
+    struct partition *p = p_;
+    block_write_multiple(p->block, p->start + sector, buffer, cnt);
+}
+
+/*! Passes request R, for partition P, on to the queue of the underlying
+    block device. */
+static void partition_submit(void *p_, struct block_request *r) {
+    struct partition *p = p_;
+    r->sector += p->start;
+    block_submit(p->block, r);
+}
+
 static struct block_operations partition_operations = {
     partition_read,
-    partition_write
+    partition_write,
+    partition_read_multiple,
+    partition_write_multiple,
+    partition_submit
 };
 
@@ -0,0 +1,134 @@
+/*! \file pci.c
+
+   Access to PCI configuration space through configuration mechanism
+   #1, which every PC chipset since the PCI bus was introduced supports.
+   Only what the disk drivers need is here: finding a function by class or
+   by ID, reading and writing its registers, and locating its I/O ports.
+   We rely on the BIOS to have assigned resources to every function. */
+
+#include "devices/pci.h"
+#include <debug.h>
+#include "threads/io.h"
+
+/*! Configuration mechanism #1 port addresses. @{ */
+#define PCI_CONFIG_ADDRESS 0xcf8        /*!< Selects a register. */
+#define PCI_CONFIG_DATA 0xcfc           /*!< Reads or writes it. */
+/*! @} */
+
+/*! Returns the value to write to PCI_CONFIG_ADDRESS to select register REG
+    of function FUNC of device DEV on bus BUS. */
+static uint32_t config_address(uint8_t bus, uint8_t dev, uint8_t func,
+                               uint8_t reg) {
+    ASSERT(dev < 32 && func < 8 && reg % 4 == 0);
+    return 0x80000000 | (bus << 16) | (dev << 11) | (func << 8) | reg;
+}
+
+static uint32_t read_config(uint8_t bus, uint8_t dev, uint8_t func,
+                            uint8_t reg) {
+    outl(PCI_CONFIG_ADDRESS, config_address(bus, dev, func, reg));
+    return inl(PCI_CONFIG_DATA);
+}
+
+/*! Walks every function on every bus, filling in *P for each one that is
+    present, until MATCH returns true for one of them.  Returns true if it
+    found such a function, false otherwise. */
+static bool scan(bool (*match)(const struct pci_device *, uint32_t aux),
+                 uint32_t aux, struct pci_device *p) {
+    int bus, dev, func;
+
+    for (bus = 0; bus < 256; bus++) {
+        for (dev = 0; dev < 32; dev++) {
+            for (func = 0; func < 8; func++) {
+                uint32_t id = read_config(bus, dev, func, PCI_REG_ID);
+                uint32_t class;
+
+                if ((id & 0xffff) == 0xffff) {
+                    /* Nothing here.  Without function 0 there can be no
+                       others either. */
+                    if (func == 0)
+                        break;
+                    continue;
+                }
+
+                class = read_config(bus, dev, func, PCI_REG_CLASS);
+                p->bus = bus;
+                p->dev = dev;
+                p->func = func;
+                p->vendor_id = id & 0xffff;
+                p->device_id = id >> 16;
+                p->class = class >> 24;
+                p->subclass = class >> 16;
+                p->prog_if = class >> 8;
+                if (match(p, aux))
+                    return true;
+
+                /* Bit 7 of the header type marks multifunction devices. */
+                if (func == 0 &&
+                    !(read_config(bus, dev, 0, PCI_REG_HEADER) & 0x800000))
+                    break;
+            }
+        }
+    }
+    return false;
+}
+
+static bool match_class(const struct pci_device *p, uint32_t aux) {
+    return p->class == (aux >> 8) && p->subclass == (aux & 0xff);
+}
+
+static bool match_id(const struct pci_device *p, uint32_t aux) {
+    return p->vendor_id == (aux >> 16) && p->device_id == (aux & 0xffff);
+}
+
+/*! Finds the first function with base class CLASS and sub-class SUBCLASS
+    and stores it in *P.  Returns true if successful, false if there is no
+    such function. */
+bool pci_find_class(uint8_t class, uint8_t subclass, struct pci_device *p) {
+    return scan(match_class, (class << 8) | subclass, p);
+}
+
+/*! Finds the first function with the given VENDOR_ID and DEVICE_ID and
+    stores it in *P.  Returns true if successful, false if there is no such
+    function. */
+bool pci_find_device(uint16_t vendor_id, uint16_t device_id,
+                     struct pci_device *p) {
+    return scan(match_id, ((uint32_t) vendor_id << 16) | device_id, p);
+}
+
+/*! Returns the 32-bit configuration register at offset REG of P. */
+uint32_t pci_read_config(const struct pci_device *p, uint8_t reg) {
+    return read_config(p->bus, p->dev, p->func, reg);
+}
+
+/*! Writes VALUE to the 32-bit configuration register at offset REG of P. */
+void pci_write_config(const struct pci_device *p, uint8_t reg,
+                      uint32_t value) {
+    outl(PCI_CONFIG_ADDRESS, config_address(p->bus, p->dev, p->func, reg));
+    outl(PCI_CONFIG_DATA, value);
+}
+
+/*! Returns the first I/O port of base address register BAR (0...5) of P,
+    or 0 if that register is unassigned or maps memory instead. */
+uint16_t pci_io_bar(const struct pci_device *p, int bar) {
+    uint32_t value;
+
+    ASSERT(bar >= 0 && bar < 6);
+    value = pci_read_config(p, PCI_REG_BAR0 + bar * 4);
+    return (value & 1) ? value & 0xfffc : 0;
+}
+
+/*! Returns the interrupt line the BIOS routed P to, as a legacy IRQ
+    number, or 0xff if P does not interrupt. */
+uint8_t pci_irq(const struct pci_device *p) {
+    return pci_read_config(p, PCI_REG_INTR) & 0xff;
+}
+
+/*! Lets P respond to I/O accesses and initiate DMA. */
+void pci_enable_bus_master(const struct pci_device *p) {
+    uint32_t command = pci_read_config(p, PCI_REG_COMMAND);
+
+    /* The upper half is the status register, whose bits are cleared by
+       writing 1s, so leave it alone. */
+    command = (command & 0xffff) | PCI_CMD_IO | PCI_CMD_BUS_MASTER;
+    pci_write_config(p, PCI_REG_COMMAND, command);
+}
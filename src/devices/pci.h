@@ -0,0 +1,45 @@
+#ifndef DEVICES_PCI_H
+#define DEVICES_PCI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*! A function on the PCI bus. */
+struct pci_device {
+    uint8_t bus;                /*!< Bus number, 0...255. */
+    uint8_t dev;                /*!< Device number, 0...31. */
+    uint8_t func;               /*!< Function number, 0...7. */
+    uint16_t vendor_id;         /*!< Vendor ID. */
+    uint16_t device_id;         /*!< Device ID. */
+    uint8_t class;              /*!< Base class code. */
+    uint8_t subclass;           /*!< Sub-class code. */
+    uint8_t prog_if;            /*!< Programming interface. */
+};
+
+/*! Configuration space register offsets. @{ */
+#define PCI_REG_ID 0x00         /*!< Device ID:Vendor ID. */
+#define PCI_REG_COMMAND 0x04    /*!< Status:Command. */
+#define PCI_REG_CLASS 0x08      /*!< Class:Subclass:Prog IF:Revision. */
+#define PCI_REG_HEADER 0x0c     /*!< BIST:Header type:Latency:Cache line. */
+#define PCI_REG_BAR0 0x10       /*!< First of six base address registers. */
+#define PCI_REG_INTR 0x3c       /*!< Max lat:Min gnt:Int pin:Int line. */
+/*! @} */
+
+/*! Command register bits. @{ */
+#define PCI_CMD_IO 0x0001           /*!< Respond to I/O space accesses. */
+#define PCI_CMD_MEMORY 0x0002       /*!< Respond to memory accesses. */
+#define PCI_CMD_BUS_MASTER 0x0004   /*!< May initiate DMA. */
+/*! @} */
+
+bool pci_find_class(uint8_t class, uint8_t subclass, struct pci_device *);
+bool pci_find_device(uint16_t vendor_id, uint16_t device_id,
+                     struct pci_device *);
+
+uint32_t pci_read_config(const struct pci_device *, uint8_t reg);
+void pci_write_config(const struct pci_device *, uint8_t reg, uint32_t);
+
+uint16_t pci_io_bar(const struct pci_device *, int bar);
+uint8_t pci_irq(const struct pci_device *);
+void pci_enable_bus_master(const struct pci_device *);
+
+#endif /* devices/pci.h */
@@ -15,9 +15,6 @@
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /*!< Counter port. */
 /*! @} */
 
-/*! PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /*! Configure the given CHANNEL in the PIT.  In a PC, the PIT's
     three output channels are hooked up like this:
 
@@ -41,6 +38,9 @@
        the second half it is 0.  This is useful for generating a tone on a
        speaker.
 
+     - Mode 0 raises the output once when the count runs out.  It is set up
+       by pit_oneshot() rather than this function.
+
      - Other modes are less useful.
 
     FREQUENCY is the number of periods per second, in Hz. */
@@ -79,3 +79,24 @@ void pit_configure_channel(int channel, int mode, int frequency) {
     intr_set_level(old_level);
 }
 
+/*! Makes CHANNEL raise its output once, after COUNT cycles of the PIT clock,
+    using mode 0, "interrupt on terminal count".  The output then stays high
+    until the channel is programmed again, which also cancels a count in
+    progress.  COUNT is clamped to what the 16-bit counter can hold, so the
+    longest delay is about 55 ms. */
+void pit_oneshot(int channel, uint32_t count) {
+    enum intr_level old_level;
+
+    ASSERT(channel == 0);
+
+    if (count < 1)
+        count = 1;
+    else if (count > 0xffff)
+        count = 0xffff;
+
+    old_level = intr_disable();
+    outb(PIT_PORT_CONTROL, (channel << 6) | 0x30);
+    outb(PIT_PORT_COUNTER(channel), count);
+    outb(PIT_PORT_COUNTER(channel), count >> 8);
+    intr_set_level(old_level);
+}
@@ -0,0 +1,111 @@
+/*! \file ramdisk.c
+
+   A block device kept in kernel memory, named "ram0".  It has no seek
+   time, no interrupts and no emulated controller, so a file system or
+   swap area placed on it with -filesys=ram0 or -swap=ram0 shows the cost
+   of the software above the block layer alone.  Its contents are lost at
+   shutdown, so a file system on it must be formatted with -f at boot.
+
+   Requests are carried out as soon as they are submitted, in the
+   submitter's thread, rather than through a queue. */
+
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/*! Number of sectors stored in one page. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/*! The RAM disk.  Its storage is a set of separately allocated pages,
+    since a large run of contiguous kernel pages may not be available. */
+struct ramdisk {
+    uint8_t **pages;            /*!< Storage, SECTORS_PER_PAGE per page. */
+    size_t page_cnt;            /*!< Number of pages. */
+};
+
+static struct ramdisk ram0;
+static struct block *ram0_block;
+
+static struct block_operations ramdisk_operations;
+
+/*! Creates and registers a RAM disk of KB kilobytes, rounded up to a whole
+    number of pages and filled with zeros.  Panics if memory runs out. */
+void ramdisk_init(size_t kb) {
+    struct ramdisk *rd = &ram0;
+    char extra_info[32];
+    size_t i;
+
+    rd->page_cnt = DIV_ROUND_UP(kb * 1024, PGSIZE);
+    rd->pages = malloc(rd->page_cnt * sizeof *rd->pages);
+    if (rd->pages == NULL)
+        PANIC("ram0: out of memory for page table");
+    for (i = 0; i < rd->page_cnt; i++) {
+        rd->pages[i] = palloc_get_page(PAL_ZERO);
+        if (rd->pages[i] == NULL)
+            PANIC("ram0: out of memory after %zu of %zu pages",
+                  i, rd->page_cnt);
+    }
+
+    snprintf(extra_info, sizeof extra_info, "%zu pages of RAM",
+             rd->page_cnt);
+    ram0_block = block_register("ram0", BLOCK_RAW, extra_info,
+                                rd->page_cnt * SECTORS_PER_PAGE,
+                                &ramdisk_operations, rd);
+}
+
+/*! Returns the address of sector SEC_NO within RD. */
+static uint8_t *sector_addr(struct ramdisk *rd, block_sector_t sec_no) {
+    ASSERT(sec_no / SECTORS_PER_PAGE < rd->page_cnt);
+    return (rd->pages[sec_no / SECTORS_PER_PAGE]
+            + sec_no % SECTORS_PER_PAGE * BLOCK_SECTOR_SIZE);
+}
+
+/*! Reads CNT sectors starting at SEC_NO from RAM disk RD_ into BUFFER. */
+static void ramdisk_read_multiple(void *rd_, block_sector_t sec_no,
+                                  void *buffer, size_t cnt) {
+    uint8_t *p = buffer;
+
+    for (; cnt > 0; cnt--, sec_no++, p += BLOCK_SECTOR_SIZE)
+        memcpy(p, sector_addr(rd_, sec_no), BLOCK_SECTOR_SIZE);
+}
+
+/*! Writes CNT sectors starting at SEC_NO to RAM disk RD_ from BUFFER. */
+static void ramdisk_write_multiple(void *rd_, block_sector_t sec_no,
+                                   const void *buffer, size_t cnt) {
+    const uint8_t *p = buffer;
+
+    for (; cnt > 0; cnt--, sec_no++, p += BLOCK_SECTOR_SIZE)
+        memcpy(sector_addr(rd_, sec_no), p, BLOCK_SECTOR_SIZE);
+}
+
+static void ramdisk_read(void *rd_, block_sector_t sec_no, void *buffer) {
+    ramdisk_read_multiple(rd_, sec_no, buffer, 1);
+}
+
+static void ramdisk_write(void *rd_, block_sector_t sec_no,
+                          const void *buffer) {
+    ramdisk_write_multiple(rd_, sec_no, buffer, 1);
+}
+
+/*! Carries out request R at once, since there is nothing to wait for. */
+static void ramdisk_submit(void *rd_, struct block_request *r) {
+    if (r->write)
+        ramdisk_write_multiple(rd_, r->sector, r->buffer, r->cnt);
+    else
+        ramdisk_read_multiple(rd_, r->sector, r->buffer, r->cnt);
+    block_complete(ram0_block, r);
+}
+
+static struct block_operations ramdisk_operations = {
+    ramdisk_read,
+    ramdisk_write,
+    ramdisk_read_multiple,
+    ramdisk_write_multiple,
+    ramdisk_submit
+};
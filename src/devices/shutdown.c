@@ -5,12 +5,16 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/lockstat.h"
+#include "threads/schedtrace.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
 #ifdef FILESYS
+#include "devices/blktrace.h"
 #include "devices/block.h"
+#include "devices/ide.h"
 #include "filesys/filesys.h"
 #endif
 
@@ -80,7 +84,9 @@ void shutdown_power_off(void) {
 
 #ifdef FILESYS
     filesys_done();
+    blktrace_dump();
 #endif
+    schedtrace_dump();
 
     print_stats();
 
@@ -106,8 +112,10 @@ void shutdown_power_off(void) {
 static void print_stats(void) {
     timer_print_stats();
     thread_print_stats();
+    lockstat_print();
 #ifdef FILESYS
     block_print_stats();
+    ide_print_stats();
 #endif
     console_print_stats();
     kbd_print_stats();
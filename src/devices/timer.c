@@ -21,31 +21,89 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
-/*! Number of timer ticks since OS booted. */
+/*! Number of timer ticks since OS booted.  In tickless mode, this is the
+    last tick the timer interrupt has processed, which may lag behind. */
 static int64_t ticks;
 
+/*! If true, program the timer for the next event instead of interrupting
+    every tick.  Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/*! In tickless mode, once timer_calibrate() has measured cycles_per_tick,
+    channel 0 of the PIT is reprogrammed after each interrupt to fire once,
+    at the earliest of the next timer expiry, the next sub-tick sleeper's
+    deadline and, while a thread is waiting to run, the next tick, which
+    keeps time slices going.  Time is kept by the TSC: tick N starts
+    (N - BASE_TICKS) * cycles_per_tick cycles after BASE_CYCLES. */
+static bool oneshot;            /*!< Tickless mode started? */
+static uint64_t base_cycles;    /*!< TSC at the start of tick BASE_TICKS. */
+static int64_t base_ticks;
+static uint64_t armed_cycles;   /*!< TSC at which the PIT will fire. */
+
+/*! Threads in a sub-tick sleep in tickless mode, soonest deadline first.
+    They only sleep for less than a tick, so there are never many. */
+static struct list hr_sleepers;
+
+/*! A thread in a sub-tick sleep. */
+struct hr_sleeper {
+    struct list_elem elem;      /*!< Element in hr_sleepers. */
+    uint64_t deadline;          /*!< TSC value at which to wake. */
+    struct thread *thread;      /*!< The sleeping thread. */
+};
+
 /*! Number of loops per timer tick.  Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
-static struct list sleeping_list;
+/*! Number of time-stamp counter cycles per timer tick.  Initialized by
+    timer_calibrate(). */
+static uint64_t cycles_per_tick;
+
+/*! Pending timers are kept in a hierarchical timing wheel.  Level 0 has a
+    slot for each of the next WHEEL_SIZE ticks.  Each slot of level L > 0
+    covers WHEEL_SIZE**L ticks, and whenever the level below wraps around,
+    the next slot of level L is emptied and its timers are added again, so
+    they move down towards level 0 as their time approaches.  Adding and
+    cancelling a timer are O(1), and so is the amortized work per tick.
+    Timers further away than the whole wheel are parked in the farthest
+    slot and simply go around again. */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+static struct list wheel[WHEEL_LEVELS][WHEEL_SIZE];
+
+/*! Next tick whose level-0 slot has not been run yet. */
+static int64_t wheel_time;
 
 static intr_handler_func timer_interrupt;
 static bool too_many_loops(unsigned loops);
 static void busy_wait(int64_t loops);
 static void real_time_sleep(int64_t num, int32_t denom);
 static void real_time_delay(int64_t num, int32_t denom);
+static void wheel_insert(struct timer *);
+static void wheel_run(void);
+static void oneshot_start(void);
+static void oneshot_arm(void);
+static void hr_sleep(uint64_t cycles);
 
 /*! Sets up the timer to interrupt TIMER_FREQ times per second,
     and registers the corresponding interrupt. */
 void timer_init(void) {
+    int level, slot;
+
     pit_configure_channel(0, 2, TIMER_FREQ);
     intr_register_ext(0x20, timer_interrupt, "8254 Timer");
-    list_init(&sleeping_list);
+    for (level = 0; level < WHEEL_LEVELS; level++)
+        for (slot = 0; slot < WHEEL_SIZE; slot++)
+            list_init(&wheel[level][slot]);
+    list_init(&hr_sleepers);
 }
 
 /*! Calibrates loops_per_tick, used to implement brief delays. */
 void timer_calibrate(void) {
     unsigned high_bit, test_bit;
+    uint64_t start_cycles;
+    int64_t start;
 
     ASSERT(intr_get_level() == INTR_ON);
     printf("Calibrating timer...  ");
@@ -66,12 +124,35 @@ void timer_calibrate(void) {
     }
 
     printf("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+    /* Count time-stamp counter cycles across one whole tick. */
+    start = timer_ticks();
+    while (timer_ticks() == start)
+        continue;
+    start_cycles = timer_cycles();
+    start = timer_ticks();
+    while (timer_ticks() == start)
+        continue;
+    cycles_per_tick = timer_cycles() - start_cycles;
+
+    if (timer_tickless)
+        oneshot_start();
 }
 
 /*! Returns the number of timer ticks since the OS booted. */
 int64_t timer_ticks(void) {
     enum intr_level old_level = intr_disable();
     int64_t t = ticks;
+
+    /* Between interrupts in tickless mode, TICKS falls behind, so threads
+       work the count out from the TSC.  Interrupt handlers see the ticks
+       processed so far, so that thread_tick() sees each one in turn. */
+    if (oneshot && !intr_context()) {
+        int64_t now = base_ticks + (int64_t) ((timer_cycles() - base_cycles)
+                                              / cycles_per_tick);
+        if (now > t)
+            t = now;
+    }
     intr_set_level(old_level);
     return t;
 }
@@ -82,28 +163,234 @@ int64_t timer_elapsed(int64_t then) {
     return timer_ticks() - then;
 }
 
-bool timer_threadcomp(const struct list_elem *a, 
-                      const struct list_elem *b, void *aux) {
-    struct thread *t1;
-    struct thread *t2;
+/*! Initializes timer T to call FUNC with AUX when it expires.  The timer
+    is not armed. */
+void timer_setup(struct timer *t, timer_func *func, void *aux) {
+    ASSERT(t != NULL);
+    ASSERT(func != NULL);
+
+    t->func = func;
+    t->aux = aux;
+    t->pending = false;
+}
+
+/*! Arms timer T to expire at tick EXPIRES, or at the next tick if EXPIRES
+    has already passed.  T must not already be pending. */
+void timer_add(struct timer *t, int64_t expires) {
+    enum intr_level old_level;
+
+    ASSERT(!t->pending);
+
+    old_level = intr_disable();
+    t->expires = expires;
+    t->pending = true;
+    wheel_insert(t);
+    if (oneshot)
+        oneshot_arm();
+    intr_set_level(old_level);
+}
+
+/*! Disarms timer T.  Returns true if T was pending, false if it had
+    already expired or was never armed. */
+bool timer_cancel(struct timer *t) {
+    enum intr_level old_level = intr_disable();
+    bool was_pending = t->pending;
+
+    if (was_pending) {
+        list_remove(&t->elem);
+        t->pending = false;
+    }
+    intr_set_level(old_level);
+    return was_pending;
+}
+
+/*! Puts pending timer T in the wheel slot for its expiry time.  Interrupts
+    must be off. */
+static void wheel_insert(struct timer *t) {
+    int64_t expires = t->expires;
+    int64_t delta = expires - wheel_time;
+    struct list *slot;
+    int level;
+
+    if (delta < 0) {
+        /* Already due: run it with the next tick. */
+        slot = &wheel[0][wheel_time & WHEEL_MASK];
+    }
+    else {
+        /* Find the lowest level whose span reaches EXPIRES. */
+        for (level = 0; level < WHEEL_LEVELS - 1; level++)
+            if (delta < (int64_t) 1 << (WHEEL_BITS * (level + 1)))
+                break;
+        if (delta >> (WHEEL_BITS * WHEEL_LEVELS) != 0)
+            expires = wheel_time + ((int64_t) 1 << (WHEEL_BITS * WHEEL_LEVELS))
+                      - 1;
+        slot = &wheel[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK];
+    }
+    list_push_back(slot, &t->elem);
+}
+
+/*! Empties slot SLOT of LEVEL, adding each of its timers again so that it
+    lands on a lower level.  Returns SLOT, so that the caller can stop
+    cascading once a level has not wrapped around. */
+static int wheel_cascade(int level, int slot) {
+    struct list timers;
+
+    list_init(&timers);
+    if (!list_empty(&wheel[level][slot]))
+        list_splice(list_end(&timers), list_begin(&wheel[level][slot]),
+                    list_end(&wheel[level][slot]));
+    while (!list_empty(&timers))
+        wheel_insert(list_entry(list_pop_front(&timers), struct timer, elem));
+    return slot;
+}
+
+/*! Runs every timer that has expired by the current tick.  Called from the
+    timer interrupt. */
+static void wheel_run(void) {
+    while (wheel_time <= ticks) {
+        struct list *slot = &wheel[0][wheel_time & WHEEL_MASK];
+        int level;
+
+        /* When level 0 wraps, pull the next slot of each level that also
+           wraps down a level. */
+        if ((wheel_time & WHEEL_MASK) == 0)
+            for (level = 1; level < WHEEL_LEVELS; level++)
+                if (wheel_cascade(level, (wheel_time >> (WHEEL_BITS * level))
+                                         & WHEEL_MASK) != 0)
+                    break;
+        wheel_time++;
+
+        /* A timer re-armed by its function for a time that has already
+           passed goes into the next slot, not this one. */
+        while (!list_empty(slot)) {
+            struct timer *t = list_entry(list_pop_front(slot), struct timer,
+                                         elem);
+            t->pending = false;
+            t->func(t->aux);
+        }
+    }
+}
+
+/*! Returns the first tick at which the wheel has work to do: either a
+    timer expires or a higher level must be cascaded. */
+static int64_t wheel_next_event(void) {
+    int64_t t;
+
+    for (t = wheel_time; ; t++)
+        if (!list_empty(&wheel[0][t & WHEEL_MASK]))
+            return t;
+        else if (((t + 1) & WHEEL_MASK) == 0)
+            return t + 1;
+}
+
+/*! Switches to tickless mode, with tick TICKS starting now. */
+static void oneshot_start(void) {
+    enum intr_level old_level = intr_disable();
+
+    base_cycles = timer_cycles();
+    base_ticks = ticks;
+    armed_cycles = UINT64_MAX;
+    oneshot = true;
+    oneshot_arm();
+    intr_set_level(old_level);
+}
+
+/*! Programs the PIT for the next event, unless it is already armed for an
+    earlier time.  Interrupts must be off. */
+static void oneshot_arm(void) {
+    uint64_t cycles_per_sec = cycles_per_tick * TIMER_FREQ;
+    uint64_t now = timer_cycles();
+    uint64_t deadline, max_cycles;
+    int64_t next = wheel_next_event();
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (thread_ready_count() > 0 || thread_mlfqs)
+        next = next < ticks + 1 ? next : ticks + 1;
+    deadline = base_cycles + (next - base_ticks) * cycles_per_tick;
+    if (!list_empty(&hr_sleepers)) {
+        struct hr_sleeper *s = list_entry(list_front(&hr_sleepers),
+                                          struct hr_sleeper, elem);
+        if (s->deadline < deadline)
+            deadline = s->deadline;
+    }
+
+    /* The PIT cannot count further than 0xffff of its cycles. */
+    if (deadline < now)
+        deadline = now;
+    max_cycles = 0xffff * cycles_per_sec / PIT_HZ;
+    if (deadline - now > max_cycles)
+        deadline = now + max_cycles;
+
+    if (deadline < armed_cycles || armed_cycles <= now) {
+        armed_cycles = deadline;
+        pit_oneshot(0, ((deadline - now) * PIT_HZ + cycles_per_sec - 1)
+                       / cycles_per_sec);
+    }
+}
 
-    t1 = list_entry(a, struct thread, elem);
-    t2 = list_entry(b, struct thread, elem);
+/*! Called when a thread becomes ready, so that tickless mode can restart
+    time slices. */
+void timer_runnable_changed(void) {
+    if (oneshot)
+        oneshot_arm();
+}
+
+/*! Returns true if sub-tick sleeper A's deadline is before B's. */
+static bool hr_sleeper_less(const struct list_elem *a,
+                            const struct list_elem *b, void *aux UNUSED) {
+    return (list_entry(a, struct hr_sleeper, elem)->deadline <
+            list_entry(b, struct hr_sleeper, elem)->deadline);
+}
+
+/*! Blocks the current thread for CYCLES cycles of the TSC, which should be
+    less than a tick.  Only for tickless mode. */
+static void hr_sleep(uint64_t cycles) {
+    struct hr_sleeper s;
+    enum intr_level old_level;
 
-    return (t1->wakeup_time < t2->wakeup_time);
+    ASSERT(oneshot);
+
+    old_level = intr_disable();
+    s.deadline = timer_cycles() + cycles;
+    s.thread = thread_current();
+    list_insert_ordered(&hr_sleepers, &s.elem, hr_sleeper_less, NULL);
+    oneshot_arm();
+    thread_block();
+    intr_set_level(old_level);
+}
+
+/*! Wakes every sub-tick sleeper whose deadline has passed. */
+static void hr_wake(void) {
+    uint64_t now = timer_cycles();
+
+    while (!list_empty(&hr_sleepers)) {
+        struct hr_sleeper *s = list_entry(list_front(&hr_sleepers),
+                                          struct hr_sleeper, elem);
+        if (s->deadline > now)
+            break;
+        list_pop_front(&hr_sleepers);
+        thread_unblock(s->thread);
+    }
+}
+
+/*! Timer function for timer_sleep(). */
+static void wake_sleeper(void *thread) {
+    thread_unblock(thread);
 }
 
 /*! Sleeps for approximately TICKS timer ticks. */
 void timer_sleep(int64_t ticks) {
-    int64_t wakeup_time = timer_ticks();
     enum intr_level old_level;
-    struct thread *curr;
+    struct timer t;
 
-    wakeup_time += ticks;
-    curr = thread_current();
-    curr->wakeup_time = wakeup_time;
+    if (ticks <= 0)
+        return;
+
+    ASSERT(intr_get_level() == INTR_ON);
+    timer_setup(&t, wake_sleeper, thread_current());
     old_level = intr_disable();
-    list_insert_ordered(&sleeping_list, &curr->elem, timer_threadcomp, NULL);
+    timer_add(&t, timer_ticks() + ticks);
     thread_block();
     intr_set_level(old_level);
 }
@@ -152,6 +439,28 @@ void timer_ndelay(int64_t ns) {
     real_time_delay(ns, 1000 * 1000 * 1000);
 }
 
+/*! Returns the CPU's time-stamp counter, which counts cycles since reset.
+    Cheap enough to bracket individual device operations. */
+uint64_t timer_cycles(void) {
+    /* See [IA32-v2b] "RDTSC". */
+    uint64_t cycles;
+    asm volatile ("rdtsc" : "=A" (cycles));
+    return cycles;
+}
+
+/*! Converts CYCLES of the time-stamp counter into microseconds.  Returns 0
+    before timer_calibrate() has run. */
+uint64_t timer_cycles_to_us(uint64_t cycles) {
+    uint64_t cycles_per_us = cycles_per_tick * TIMER_FREQ / 1000000;
+    return cycles_per_us != 0 ? cycles / cycles_per_us : 0;
+}
+
+/*! Returns the rate of the time-stamp counter in cycles per second, or 0
+    before timer_calibrate() has run. */
+uint64_t timer_cycles_per_sec(void) {
+    return cycles_per_tick * TIMER_FREQ;
+}
+
 /*! Prints timer statistics. */
 void timer_print_stats(void) {
     printf("Timer: %"PRId64" ticks\n", timer_ticks());
@@ -159,25 +468,25 @@ void timer_print_stats(void) {
 
 /*! Timer interrupt handler. */
 static void timer_interrupt(struct intr_frame *args UNUSED) {
-    struct thread *t;
-    
-    ticks++;
-    if (!list_empty(&sleeping_list)) {
-        t = list_entry(list_front(&sleeping_list), struct thread, elem);
-        while (t && t->wakeup_time <= ticks) {
-            list_pop_front(&sleeping_list);
-            thread_unblock(t);
-            if (!list_empty(&sleeping_list)) {
-                t = list_entry(list_front(&sleeping_list), struct thread, 
-                               elem);
-            }
-            else {
-                t = NULL;
-            }
+    if (oneshot) {
+        /* Catch up on every tick that has started since the last
+           interrupt, then wait for the next event. */
+        int64_t now = base_ticks + (int64_t) ((timer_cycles() - base_cycles)
+                                              / cycles_per_tick);
+        while (ticks < now) {
+            ticks++;
+            wheel_run();
+            thread_tick();
         }
+        hr_wake();
+        armed_cycles = UINT64_MAX;
+        oneshot_arm();
+    }
+    else {
+        ticks++;
+        wheel_run();
+        thread_tick();
     }
-
-    thread_tick();
 }
 
 /*! Returns true if LOOPS iterations waits for more than one timer tick,
@@ -223,6 +532,12 @@ static void real_time_sleep(int64_t num, int32_t denom) {
            because it will yield the CPU to other processes. */                
         timer_sleep(ticks); 
     }
+    else if (oneshot) {
+        /* In tickless mode the timer can wake us at any time, so even a
+           sub-tick sleep need not spin. */
+        if (num > 0)
+            hr_sleep(num * cycles_per_tick * TIMER_FREQ / denom);
+    }
     else {
         /* Otherwise, use a busy-wait loop for more accurate sub-tick timing. */
         real_time_delay(num, denom); 
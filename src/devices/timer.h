@@ -1,18 +1,44 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /*! Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/*! If true, program the timer for the next event instead of interrupting
+    every tick.  Controlled by kernel command-line option "-tickless". */
+extern bool timer_tickless;
+
+/*! Function called when a timer expires.  It runs in the timer interrupt
+    handler, so it must not sleep. */
+typedef void timer_func(void *aux);
+
+/*! A one-shot timer.  The owner embeds it in a longer-lived structure,
+    initializes it with timer_setup() and arms it with timer_add(). */
+struct timer {
+    struct list_elem elem;      /*!< Element in a timer wheel slot. */
+    int64_t expires;            /*!< Tick at which to call FUNC. */
+    timer_func *func;           /*!< Function to call. */
+    void *aux;                  /*!< Argument for FUNC. */
+    bool pending;               /*!< Armed and not yet expired? */
+};
+
 void timer_init(void);
 void timer_calibrate(void);
 
 int64_t timer_ticks(void);
 int64_t timer_elapsed(int64_t);
 
+/* Timers. */
+void timer_setup(struct timer *, timer_func *, void *aux);
+void timer_add(struct timer *, int64_t expires);
+bool timer_cancel(struct timer *);
+void timer_runnable_changed(void);
+
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep(int64_t ticks);
 void timer_msleep(int64_t milliseconds);
@@ -24,6 +50,11 @@ void timer_mdelay(int64_t milliseconds);
 void timer_udelay(int64_t microseconds);
 void timer_ndelay(int64_t nanoseconds);
 
+/* Cycle counter. */
+uint64_t timer_cycles(void);
+uint64_t timer_cycles_to_us(uint64_t cycles);
+uint64_t timer_cycles_per_sec(void);
+
 void timer_print_stats(void);
 
 #endif /* devices/timer.h */
@@ -0,0 +1,439 @@
+/*! \file virtio-blk.c
+
+   Driver for the first legacy ("transitional") virtio block device on the
+   PCI bus, as provided by QEMU's -drive if=virtio.  See [Virtio] for the
+   device interface.
+
+   Unlike an IDE disk, which costs a trip to the emulator on every port
+   access, a virtio disk is driven through a ring of descriptors in shared
+   memory: the driver fills in a request, makes it available and notifies
+   the device once, and the device interrupts when it has used requests.
+   Many requests can be outstanding at once, so this driver takes requests
+   straight from block_submit() instead of through the block layer's
+   one-at-a-time dispatcher, and a completion thread finishes them.
+
+   The device may finish requests in any order, so the driver keeps the
+   dispatcher's rule itself: a request that overlaps one already in flight,
+   or one submitted earlier and still held back, is held until those
+   complete.  A read thus always sees every write submitted before it. */
+
+#include "devices/virtio-blk.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "devices/partition.h"
+#include "devices/pci.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/*! PCI IDs of a legacy virtio block device. @{ */
+#define VIRTIO_VENDOR_ID 0x1af4
+#define VIRTIO_BLK_DEVICE_ID 0x1001
+/*! @} */
+
+/*! Legacy virtio register offsets, relative to BAR 0. @{ */
+#define VIRTIO_REG_HOST_FEATURES 0x00   /*!< Device features (32-bit). */
+#define VIRTIO_REG_GUEST_FEATURES 0x04  /*!< Driver features (32-bit). */
+#define VIRTIO_REG_QUEUE_PFN 0x08       /*!< Queue page number (32-bit). */
+#define VIRTIO_REG_QUEUE_SIZE 0x0c      /*!< Queue size (16-bit, r/o). */
+#define VIRTIO_REG_QUEUE_SELECT 0x0e    /*!< Queue select (16-bit). */
+#define VIRTIO_REG_QUEUE_NOTIFY 0x10    /*!< Queue notify (16-bit). */
+#define VIRTIO_REG_STATUS 0x12          /*!< Device status (8-bit). */
+#define VIRTIO_REG_ISR 0x13             /*!< ISR status, clears on read. */
+#define VIRTIO_REG_BLK_CAPACITY 0x14    /*!< Sectors (64-bit). */
+/*! @} */
+
+/*! Device status bits. @{ */
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x01  /*!< Guest has noticed device. */
+#define VIRTIO_STATUS_DRIVER 0x02       /*!< Guest can drive it. */
+#define VIRTIO_STATUS_DRIVER_OK 0x04    /*!< Driver is ready. */
+#define VIRTIO_STATUS_FAILED 0x80       /*!< Guest gave up on it. */
+/*! @} */
+
+/*! Alignment of the used ring in a legacy virtqueue. */
+#define VIRTQ_ALIGN PGSIZE
+
+/*! A buffer descriptor. */
+struct virtq_desc {
+    uint64_t addr;              /*!< Physical address. */
+    uint32_t len;               /*!< Length in bytes. */
+    uint16_t flags;             /*!< VIRTQ_DESC_F_*. */
+    uint16_t next;              /*!< Next descriptor, with F_NEXT. */
+};
+
+/*! Descriptor flags. @{ */
+#define VIRTQ_DESC_F_NEXT 1     /*!< Chain continues in NEXT. */
+#define VIRTQ_DESC_F_WRITE 2    /*!< Device writes, rather than reads. */
+/*! @} */
+
+/*! Ring of descriptor chains the driver offers to the device. */
+struct virtq_avail {
+    uint16_t flags;
+    uint16_t idx;               /*!< Where the driver puts the next entry. */
+    uint16_t ring[];            /*!< Heads of descriptor chains. */
+};
+
+/*! Ring of descriptor chains the device has finished with. */
+struct virtq_used {
+    uint16_t flags;
+    uint16_t idx;               /*!< Where the device puts the next entry. */
+    struct virtq_used_elem {
+        uint32_t id;            /*!< Head of the finished chain. */
+        uint32_t len;           /*!< Bytes the device wrote. */
+    } ring[];
+};
+
+/*! Header of a block request, read by the device. */
+struct virtio_blk_req {
+    uint32_t type;              /*!< VIRTIO_BLK_T_*. */
+    uint32_t reserved;
+    uint64_t sector;            /*!< First sector. */
+};
+
+/*! Request types. @{ */
+#define VIRTIO_BLK_T_IN 0       /*!< Read. */
+#define VIRTIO_BLK_T_OUT 1      /*!< Write. */
+/*! @} */
+
+/*! Most requests outstanding at once.  Each takes three descriptors. */
+#define VIRTIO_BLK_MAX_SLOTS 64
+
+/*! An outstanding request.  Slot I uses descriptors 3*I...3*I+2. */
+struct slot {
+    struct virtio_blk_req hdr;  /*!< Request header. */
+    uint8_t status;             /*!< Written by the device; 0 is success. */
+    struct block_request *r;    /*!< Block layer request. */
+};
+
+/*! The virtio disk. */
+struct virtio_blk {
+    uint16_t iobase;            /*!< First I/O port. */
+    uint16_t qsize;             /*!< Entries in the virtqueue. */
+    struct virtq_desc *desc;    /*!< Descriptor table. */
+    struct virtq_avail *avail;  /*!< Available ring. */
+    struct virtq_used *used;    /*!< Used ring. */
+    uint16_t last_used;         /*!< Next used entry to look at. */
+
+    struct slot *slots;         /*!< Outstanding requests. */
+    int slot_cnt;               /*!< Number of slots. */
+    int free_slots[VIRTIO_BLK_MAX_SLOTS];   /*!< Stack of free slots. */
+    int free_cnt;               /*!< Number of free slots. */
+    struct list held;           /*!< Requests held back by an overlapping
+                                     one, oldest first. */
+
+    struct lock lock;           /*!< Protects the rings and slots. */
+    struct semaphore slot_sema; /*!< Counts free slots. */
+    struct semaphore irq_sema;  /*!< Up'd by the interrupt handler. */
+    struct block *block;        /*!< Registered block device. */
+};
+
+static struct virtio_blk vda;
+
+static struct block_operations virtio_blk_operations;
+
+static bool setup_queue(struct virtio_blk *);
+static bool must_hold(struct virtio_blk *, struct block_request *,
+                      struct list_elem *held_end);
+static void issue(struct virtio_blk *, struct block_request *);
+static void issue_held(struct virtio_blk *);
+static void interrupt_handler(struct intr_frame *);
+static void completion_thread(void *vb_);
+
+/*! Looks for a virtio block device and, if there is one, sets it up and
+    registers it as "vda", then scans it for partitions. */
+void virtio_blk_init(void) {
+    struct virtio_blk *vb = &vda;
+    struct pci_device p;
+    block_sector_t capacity;
+    uint8_t irq;
+
+    if (!pci_find_device(VIRTIO_VENDOR_ID, VIRTIO_BLK_DEVICE_ID, &p))
+        return;
+    vb->iobase = pci_io_bar(&p, 0);
+    irq = pci_irq(&p);
+    if (vb->iobase == 0 || irq >= 16) {
+        printf("vda: no I/O ports or interrupt assigned\n");
+        return;
+    }
+    pci_enable_bus_master(&p);
+
+    /* Reset the device, then tell it we know how to drive it.  We want
+       none of the optional features. */
+    outb(vb->iobase + VIRTIO_REG_STATUS, 0);
+    outb(vb->iobase + VIRTIO_REG_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+    outb(vb->iobase + VIRTIO_REG_STATUS,
+         VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+    outl(vb->iobase + VIRTIO_REG_GUEST_FEATURES, 0);
+
+    if (!setup_queue(vb)) {
+        outb(vb->iobase + VIRTIO_REG_STATUS, VIRTIO_STATUS_FAILED);
+        return;
+    }
+
+    lock_init(&vb->lock);
+    list_init(&vb->held);
+    sema_init(&vb->slot_sema, vb->free_cnt);
+    sema_init(&vb->irq_sema, 0);
+    intr_register_ext(irq + 0x20, interrupt_handler, "virtio-blk");
+    thread_create("vda", PRI_MAX, completion_thread, vb);
+
+    outb(vb->iobase + VIRTIO_REG_STATUS, VIRTIO_STATUS_ACKNOWLEDGE
+         | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+
+    /* Block sector numbers are 32 bits, so larger disks are cut short. */
+    capacity = inl(vb->iobase + VIRTIO_REG_BLK_CAPACITY);
+    if (inl(vb->iobase + VIRTIO_REG_BLK_CAPACITY + 4) != 0)
+        capacity = UINT32_MAX;
+
+    vb->block = block_register("vda", BLOCK_RAW, "virtio", capacity,
+                               &virtio_blk_operations, vb);
+    partition_scan(vb->block);
+}
+
+/*! Allocates virtqueue 0 of VB, the only one a block device has, and
+    hands it to the device.  Returns true if successful. */
+static bool setup_queue(struct virtio_blk *vb) {
+    size_t avail_end, used_ofs, size, i;
+    uint8_t *mem;
+
+    outw(vb->iobase + VIRTIO_REG_QUEUE_SELECT, 0);
+    vb->qsize = inw(vb->iobase + VIRTIO_REG_QUEUE_SIZE);
+    if (vb->qsize == 0)
+        return false;
+
+    /* The legacy layout puts the descriptor table and the available ring
+       together, and the used ring on the next page boundary.  The whole
+       queue must be physically contiguous, which a run of kernel pages
+       is. */
+    avail_end = sizeof *vb->desc * vb->qsize
+                + sizeof *vb->avail + sizeof (uint16_t) * (vb->qsize + 1);
+    used_ofs = ROUND_UP(avail_end, VIRTQ_ALIGN);
+    size = used_ofs + sizeof *vb->used
+           + sizeof (struct virtq_used_elem) * vb->qsize + sizeof (uint16_t);
+    mem = palloc_get_multiple(PAL_ZERO, DIV_ROUND_UP(size, PGSIZE));
+    vb->slots = malloc(sizeof *vb->slots * VIRTIO_BLK_MAX_SLOTS);
+    if (mem == NULL || vb->slots == NULL) {
+        printf("vda: out of memory for virtqueue\n");
+        return false;
+    }
+
+    vb->desc = (struct virtq_desc *) mem;
+    vb->avail = (struct virtq_avail *) (mem + sizeof *vb->desc * vb->qsize);
+    vb->used = (struct virtq_used *) (mem + used_ofs);
+    vb->last_used = 0;
+
+    vb->free_cnt = vb->qsize / 3;
+    if (vb->free_cnt > VIRTIO_BLK_MAX_SLOTS)
+        vb->free_cnt = VIRTIO_BLK_MAX_SLOTS;
+    vb->slot_cnt = vb->free_cnt;
+    for (i = 0; i < (size_t) vb->free_cnt; i++) {
+        vb->free_slots[i] = i;
+        vb->slots[i].r = NULL;
+    }
+
+    outl(vb->iobase + VIRTIO_REG_QUEUE_PFN, vtop(mem) / PGSIZE);
+    return true;
+}
+
+/*! Queues request R on virtio disk VB_ and notifies the device, or holds
+    R back if it overlaps an earlier request that has not completed.
+    Waits only if every slot is in use.  The completion thread finishes
+    R. */
+static void virtio_blk_submit(void *vb_, struct block_request *r) {
+    struct virtio_blk *vb = vb_;
+
+    /* Kernel virtual memory maps physical memory one-to-one, so the
+       buffer is physically contiguous. */
+    ASSERT(is_kernel_vaddr(r->buffer));
+
+    sema_down(&vb->slot_sema);
+    lock_acquire(&vb->lock);
+    if (must_hold(vb, r, list_end(&vb->held))) {
+        list_push_back(&vb->held, &r->elem);
+        lock_release(&vb->lock);
+        sema_up(&vb->slot_sema);
+        return;
+    }
+    issue(vb, r);
+    lock_release(&vb->lock);
+}
+
+/*! Returns true if R overlaps a request in flight on VB, or one of the
+    held requests before HELD_END.  The caller must hold VB's lock. */
+static bool must_hold(struct virtio_blk *vb, struct block_request *r,
+                      struct list_elem *held_end) {
+    struct list_elem *e;
+    int i;
+
+    for (i = 0; i < vb->slot_cnt; i++) {
+        struct block_request *q = vb->slots[i].r;
+        if (q != NULL && q->sector < r->sector + r->cnt &&
+            r->sector < q->sector + q->cnt)
+            return true;
+    }
+    for (e = list_begin(&vb->held); e != held_end; e = list_next(e)) {
+        struct block_request *q = list_entry(e, struct block_request, elem);
+        if (q->sector < r->sector + r->cnt && r->sector < q->sector + q->cnt)
+            return true;
+    }
+    return false;
+}
+
+/*! Issues the held requests of VB that no longer overlap an earlier one,
+    oldest first, for as long as there are free slots.  The caller must
+    hold VB's lock. */
+static void issue_held(struct virtio_blk *vb) {
+    struct list_elem *e = list_begin(&vb->held);
+
+    while (e != list_end(&vb->held)) {
+        struct block_request *r = list_entry(e, struct block_request, elem);
+
+        if (must_hold(vb, r, e)) {
+            e = list_next(e);
+            continue;
+        }
+        if (!sema_try_down(&vb->slot_sema))
+            break;
+        e = list_remove(e);
+        issue(vb, r);
+    }
+}
+
+/*! Puts request R in a free slot of VB and notifies the device.  A slot
+    must have been reserved through VB's slot_sema, and the caller must
+    hold VB's lock. */
+static void issue(struct virtio_blk *vb, struct block_request *r) {
+    struct virtq_desc *d;
+    struct slot *s;
+    int slot;
+
+    slot = vb->free_slots[--vb->free_cnt];
+    s = &vb->slots[slot];
+    s->r = r;
+    s->hdr.type = r->write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+    s->hdr.reserved = 0;
+    s->hdr.sector = r->sector;
+    s->status = 0xff;
+
+    d = &vb->desc[slot * 3];
+    d[0].addr = vtop(&s->hdr);
+    d[0].len = sizeof s->hdr;
+    d[0].flags = VIRTQ_DESC_F_NEXT;
+    d[0].next = slot * 3 + 1;
+    d[1].addr = vtop(r->buffer);
+    d[1].len = r->cnt * BLOCK_SECTOR_SIZE;
+    d[1].flags = VIRTQ_DESC_F_NEXT | (r->write ? 0 : VIRTQ_DESC_F_WRITE);
+    d[1].next = slot * 3 + 2;
+    d[2].addr = vtop(&s->status);
+    d[2].len = sizeof s->status;
+    d[2].flags = VIRTQ_DESC_F_WRITE;
+    d[2].next = 0;
+
+    /* The device may look at the ring as soon as idx moves, so the entry
+       must be in place first. */
+    vb->avail->ring[vb->avail->idx % vb->qsize] = slot * 3;
+    barrier();
+    vb->avail->idx++;
+    barrier();
+    outw(vb->iobase + VIRTIO_REG_QUEUE_NOTIFY, 0);
+}
+
+/*! Completion callback for transfer(). */
+static void wake_waiter(struct block_request *r) {
+    sema_up(r->aux);
+}
+
+/*! Moves sector SEC_NO between VB and BUFFER, as WRITE says, and waits
+    for it.  The request bypasses block_submit(), which counts everything
+    that goes through the block layer, so it is left out of the
+    statistics. */
+static void transfer(struct virtio_blk *vb, bool write,
+                     block_sector_t sec_no, void *buffer) {
+    struct block_request r;
+    struct semaphore done;
+
+    sema_init(&done, 0);
+    block_request_init(&r, write, sec_no, buffer, 1, wake_waiter, &done);
+    virtio_blk_submit(vb, &r);
+    sema_down(&done);
+}
+
+/*! Reads sector SEC_NO into BUFFER.  The block layer hands every
+    request to virtio_blk_submit(), so this and virtio_blk_write() only
+    serve direct callers of the driver operations. */
+static void virtio_blk_read(void *vb_, block_sector_t sec_no, void *buffer) {
+    transfer(vb_, false, sec_no, buffer);
+}
+
+/*! Writes sector SEC_NO from BUFFER. */
+static void virtio_blk_write(void *vb_, block_sector_t sec_no,
+                             const void *buffer) {
+    transfer(vb_, true, sec_no, (void *) buffer);
+}
+
+static struct block_operations virtio_blk_operations = {
+    virtio_blk_read,
+    virtio_blk_write,
+    NULL,
+    NULL,
+    virtio_blk_submit
+};
+
+/*! Main function for the completion thread, which finishes the requests
+    the device has used.  Completion callbacks may not run in an interrupt
+    handler, since they may free memory. */
+static void completion_thread(void *vb_) {
+    struct virtio_blk *vb = vb_;
+    struct list done;
+
+    list_init(&done);
+    while (true) {
+        sema_down(&vb->irq_sema);
+
+        lock_acquire(&vb->lock);
+        while (vb->last_used != vb->used->idx) {
+            struct virtq_used_elem *e;
+            struct slot *s;
+
+            barrier();
+            e = &vb->used->ring[vb->last_used % vb->qsize];
+            s = &vb->slots[e->id / 3];
+            if (s->status != 0)
+                PANIC("vda: I/O error, sector=%"PRDSNu, s->r->sector);
+            list_push_back(&done, &s->r->elem);
+            s->r = NULL;
+            vb->free_slots[vb->free_cnt++] = e->id / 3;
+            vb->last_used++;
+        }
+        lock_release(&vb->lock);
+
+        while (!list_empty(&done)) {
+            struct block_request *r = list_entry(list_pop_front(&done),
+                                                 struct block_request, elem);
+            if (r->origin != NULL)
+                block_complete(vb->block, r);
+            else if (r->complete != NULL)
+                r->complete(r);
+            sema_up(&vb->slot_sema);
+        }
+
+        /* Requests held back by the ones just finished may go now. */
+        lock_acquire(&vb->lock);
+        issue_held(vb);
+        lock_release(&vb->lock);
+    }
+}
+
+/*! Virtio interrupt handler.  Reading the ISR status acknowledges the
+    interrupt. */
+static void interrupt_handler(struct intr_frame *f UNUSED) {
+    if (inb(vda.iobase + VIRTIO_REG_ISR) & 1)
+        sema_up(&vda.irq_sema);
+}
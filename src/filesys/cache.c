@@ -1,26 +1,47 @@
 #include <list.h>
+#include <string.h>
 #include "devices/block.h"
 #include "devices/timer.h"
+#include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "filesys/filesys.h"
 #include "filesys/cache.h"
+#include "filesys/inode.h"
 #include "threads/thread.h"
 #include "threads/malloc.h"
+#include "threads/workqueue.h"
 
-block_sector_t just_read;
-struct semaphore read_ahead_lock;
+/*! A copy of a dirty block on its way to disk, so that the block itself
+    can be reused at once */
+struct cache_writeback {
+    struct block_request request;       /* Write request */
+    struct inode *owner;                /* Inode that dirtied the block */
+    uint8_t data[BLOCK_SECTOR_SIZE];    /* Contents being written */
+};
+
+static void cache_read_ahead(block_sector_t sector);
+static void cache_unlink_dirty(struct cache_entry *c);
+
+/*! Periodic write-back, run on system_wq every CACHE_WRITE_TIME */
+static struct work cache_write_work;
+
+/*! Set under the cache lock once the cache is shut down.  Cancelling
+    cache_write_work cannot stop a run that has already started, so that
+    run checks this before writing or queueing itself again */
+static bool cache_stopped;
 
 /*! Initialize the cache system */
 void cache_init(void) {
     list_init(&filesys_cache.cache_list);
-    lock_init(&filesys_cache.cache_lock);
+    lock_init_named(&filesys_cache.cache_lock, "buffer cache");
     filesys_cache.cache_count = 0;
     filesys_cache.evict_pointer = NULL;
-    sema_init(&read_ahead_lock, 0);
-    /* Create ghost thread for periodical write-back */
-    thread_create("cache write background", PRI_DEFAULT, 
-                  cache_write_background, NULL);
-    thread_create("cache read ahead", PRI_MIN + 1, cache_read_ahead, NULL);
+    list_init(&filesys_cache.dirty_inodes);
+    list_init(&filesys_cache.dirty_orphans);
+    /* Schedule the periodic write-back.  It is background work, so
+       anything else on the workqueue goes first. */
+    work_init(&cache_write_work, cache_write_background, NULL, PRI_MIN);
+    workqueue_queue_delayed(&system_wq, &cache_write_work, CACHE_WRITE_TIME);
 }
 
 /*! Find a cache in the cache list that corresponds to a given sector */
@@ -40,16 +61,26 @@ struct cache_entry *cache_find(block_sector_t sector) {
 }
 
 /*! Find a cache that corresponds to a given sector, or create one if needed,
-    and import the sector from the disk if the cache is created here */
-static struct cache_entry *cache_readin(block_sector_t sector, bool dirty) {
+    and import the sector from the disk if the cache is created here and
+    FILL is set.  The caller must hold the cache lock, which is released
+    while waiting for a block that is still being filled */
+static struct cache_entry *cache_readin(block_sector_t sector, bool fill) {
 
     struct cache_entry *result;
     
     /* If the cache already exists */
     if ((result = cache_find(sector)) != NULL) {
-        result->dirty |= dirty;
         result->open_count++;
         result->accessed = true;
+        /* Wait out a read-ahead or overwrite of the block, passing the
+           wakeup on to any other waiter.  The open count keeps the block
+           from being evicted while the cache lock is let go */
+        if (result->loading) {
+            lock_release(&filesys_cache.cache_lock);
+            sema_down(&result->loaded);
+            sema_up(&result->loaded);
+            lock_acquire(&filesys_cache.cache_lock);
+        }
         return result;
     }
     /* If there is room for one more cache block, create one */
@@ -59,6 +90,7 @@ static struct cache_entry *cache_readin(block_sector_t sector, bool dirty) {
             PANIC("MALLOC FAILURE: not enough memory for cache");
         list_push_back(&filesys_cache.cache_list, &result->elem);
         filesys_cache.cache_count++;
+        sema_init(&result->loaded, 0);
     }
     else 
     /* If the cache system is full, evict an existing cache to make room */
@@ -66,10 +98,13 @@ static struct cache_entry *cache_readin(block_sector_t sector, bool dirty) {
     if (result) {
         /* Initialize the created/evicted cache */
         result->sector = sector;
-        result->dirty = dirty;
+        result->dirty = false;
+        result->owner = NULL;
         result->accessed = true;
         result->open_count = 1;
-        block_read(fs_device, sector, result->cache_block);
+        result->loading = false;
+        if (fill)
+            block_read(fs_device, sector, result->cache_block);
     }
     else {
         PANIC("EVICTION FAILURE: cache eviction undefined bug");
@@ -84,16 +119,175 @@ struct cache_entry *cache_get(block_sector_t sector, bool dirty) {
     struct cache_entry *result;
 
     lock_acquire(&filesys_cache.cache_lock);
-    result = cache_readin(sector, dirty);
+    result = cache_readin(sector, true);
+    if (!dirty)
+        cache_read_ahead(sector + 1);
     lock_release(&filesys_cache.cache_lock);
-    if (!dirty) {
-        just_read = sector;
-        sema_up(&read_ahead_lock);
-    }
         
     return result;
 }
 
+/*! Get a cache-block for SECTOR and overwrite it in full with the
+    BLOCK_SECTOR_SIZE bytes at DATA, without reading the sector from disk.
+    A newly allocated block still holds the bytes of the sector it last
+    cached, so it is marked loading until the copy is done, and
+    cache_readin() makes any other thread that finds it wait.  DATA may be
+    a user page that has to be faulted in, and faulting in an mmapped page
+    of this very sector would wait on the block being loaded, so DATA is
+    first copied to a bounce sector while nothing is held */
+struct cache_entry *cache_get_overwrite(block_sector_t sector,
+                                        const void *data) {
+    struct cache_entry *result;
+    uint8_t bounce[BLOCK_SECTOR_SIZE];
+    bool fresh;
+
+    memcpy(bounce, data, BLOCK_SECTOR_SIZE);
+
+    lock_acquire(&filesys_cache.cache_lock);
+    fresh = cache_find(sector) == NULL;
+    result = cache_readin(sector, false);
+    if (fresh) {
+        result->loading = true;
+        sema_init(&result->loaded, 0);
+    }
+    lock_release(&filesys_cache.cache_lock);
+
+    memcpy(result->cache_block, bounce, BLOCK_SECTOR_SIZE);
+    if (fresh) {
+        result->loading = false;
+        sema_up(&result->loaded);
+    }
+
+    return result;
+}
+
+/*! Record that C has been modified on behalf of OWNER, which may be NULL
+    for blocks that belong to no open inode.  A dirty block sits on the
+    dirty list of its owner until it is written back, and an owner with
+    dirty blocks sits on the cache's list of dirty inodes.  A block left on
+    the orphan list by a closed inode is handed to OWNER, so that syncing
+    the reopened file writes it too */
+void cache_mark_dirty(struct cache_entry *c, struct inode *owner) {
+    lock_acquire(&filesys_cache.cache_lock);
+    if (c->dirty && c->owner == NULL && owner != NULL)
+        cache_unlink_dirty(c);
+    if (!c->dirty) {
+        c->dirty = true;
+        c->owner = owner;
+        if (owner == NULL)
+            list_push_back(&filesys_cache.dirty_orphans, &c->dirty_elem);
+        else {
+            if (list_empty(&owner->dirty_sectors))
+                list_push_back(&filesys_cache.dirty_inodes, 
+                               &owner->dirty_elem);
+            list_push_back(&owner->dirty_sectors, &c->dirty_elem);
+        }
+    }
+    lock_release(&filesys_cache.cache_lock);
+}
+
+/*! Take a dirty block off its dirty list, dropping its owner from the
+    list of dirty inodes if this was the owner's last dirty block.  The
+    caller must hold the cache lock */
+static void cache_unlink_dirty(struct cache_entry *c) {
+    ASSERT(c->dirty);
+
+    list_remove(&c->dirty_elem);
+    if (c->owner != NULL && list_empty(&c->owner->dirty_sectors))
+        list_remove(&c->owner->dirty_elem);
+    c->owner = NULL;
+    c->dirty = false;
+}
+
+/*! Completion callback for an asynchronous write-back, which wakes
+    anyone waiting for the owner's last write-back to finish */
+static void cache_written(struct block_request *r) {
+    struct cache_writeback *wb = r->aux;
+    struct inode *owner = wb->owner;
+    enum intr_level old_level;
+
+    if (owner != NULL) {
+        old_level = intr_disable();
+        if (--owner->writebacks == 0) {
+            for (; owner->writeback_waiters > 0; owner->writeback_waiters--)
+                sema_up(&owner->writeback_done);
+        }
+        intr_set_level(old_level);
+    }
+    free(wb);
+}
+
+/*! Wait until none of the write-backs of INODE's blocks is in flight */
+static void cache_wait_writebacks(struct inode *inode) {
+    enum intr_level old_level;
+
+    old_level = intr_disable();
+    while (inode->writebacks > 0) {
+        inode->writeback_waiters++;
+        sema_down(&inode->writeback_done);
+    }
+    intr_set_level(old_level);
+}
+
+/*! Write a dirty block back to disk and mark it clean.  If WAIT is false
+    the block is copied and queued for writing, and the function returns
+    without waiting for the disk.  The caller must hold the cache lock */
+static void cache_clean(struct cache_entry *c, bool wait) {
+    struct cache_writeback *wb = wait ? NULL : malloc(sizeof *wb);
+    enum intr_level old_level;
+
+    if (wb != NULL) {
+        memcpy(wb->data, c->cache_block, BLOCK_SECTOR_SIZE);
+        wb->owner = c->owner;
+        if (wb->owner != NULL) {
+            old_level = intr_disable();
+            wb->owner->writebacks++;
+            intr_set_level(old_level);
+        }
+        block_request_init(&wb->request, true, c->sector, wb->data, 1,
+                           cache_written, wb);
+        block_submit(fs_device, &wb->request);
+    }
+    else
+        block_write(fs_device, c->sector, &c->cache_block);
+    cache_unlink_dirty(c);
+}
+
+/*! Write back every dirty block of INODE, and wait for those writes and
+    for any of its blocks that were already queued for writing.  Writes
+    of other inodes and devices are not waited for */
+void cache_flush_inode(struct inode *inode) {
+    lock_acquire(&filesys_cache.cache_lock);
+    while (!list_empty(&inode->dirty_sectors))
+        cache_clean(list_entry(list_front(&inode->dirty_sectors), 
+                               struct cache_entry, dirty_elem), false);
+    lock_release(&filesys_cache.cache_lock);
+    cache_wait_writebacks(inode);
+}
+
+/*! Detach the dirty blocks of INODE, which is about to be freed.  They are
+    handed to the orphan list to be written back later, or simply marked
+    clean if DISCARD is set because their sectors are being released.
+    Waits for the write-backs of INODE's blocks already in flight */
+void cache_release_inode(struct inode *inode, bool discard) {
+    struct cache_entry *c;
+
+    lock_acquire(&filesys_cache.cache_lock);
+    while (!list_empty(&inode->dirty_sectors)) {
+        c = list_entry(list_front(&inode->dirty_sectors), 
+                       struct cache_entry, dirty_elem);
+        cache_unlink_dirty(c);
+        if (!discard) {
+            c->dirty = true;
+            list_push_back(&filesys_cache.dirty_orphans, &c->dirty_elem);
+        }
+    }
+    lock_release(&filesys_cache.cache_lock);
+
+    /* Write-backs still in flight point back at INODE */
+    cache_wait_writebacks(inode);
+}
+
 /*! Evict a cache block from the cache list */
 struct cache_entry *cache_evict(void) {
     struct cache_entry *result;
@@ -106,11 +300,11 @@ struct cache_entry *cache_evict(void) {
         result = list_entry(curr, struct cache_entry, elem);
         if (result->accessed)
             result->accessed = false;
-        else if (result->open_count == 0) {
+        else if (result->open_count == 0 && !result->loading) {
             /* If no thread is actively accessing it */
             if (result->dirty) {
-                /* Write the cache back if dirty */
-                block_write(fs_device, result->sector, &result->cache_block);
+                /* Queue the cache for writing back if dirty */
+                cache_clean(result, false);
             }
             /* Set the evict_pointer to the next element in the list */
             if (curr->next == list_end(&filesys_cache.cache_list))
@@ -128,51 +322,81 @@ struct cache_entry *cache_evict(void) {
     return NULL;
 }
 
-/* Write every dirty cache block back to disk and clear the dirty bit */
+/* Write every dirty cache block back to disk and clear the dirty bit.
+   Only the dirty lists are walked, so clean inodes and clean blocks cost
+   nothing.  The blocks are only queued for writing, unless SHUT is set, in
+   which case this waits until everything is on disk and stops the cache.
+   Does nothing once the cache is stopped */
 void cache_write_to_disk(bool shut) {
-    struct list_elem *curr = list_begin(&filesys_cache.cache_list);
-    struct cache_entry *curr_cache;
+    struct list_elem *curr;
     struct list_elem *next;
+    struct inode *inode;
 
-    if (shut)
-        just_read = -1;
     lock_acquire(&filesys_cache.cache_lock);
-    while (curr && curr->next) {
-        next = list_next(curr);
-        curr_cache = list_entry(curr, struct cache_entry, elem);
-        if (curr_cache->dirty) {
-            block_write(fs_device, curr_cache->sector, 
-                        &curr_cache->cache_block);
-            curr_cache->dirty = false;
-        }
-        if (shut) {
-            /* Used for freeing the cache system */
+    if (cache_stopped) {
+        lock_release(&filesys_cache.cache_lock);
+        return;
+    }
+    while (!list_empty(&filesys_cache.dirty_inodes)) {
+        inode = list_entry(list_front(&filesys_cache.dirty_inodes), 
+                           struct inode, dirty_elem);
+        /* The inode leaves the list along with its last dirty block */
+        while (!list_empty(&inode->dirty_sectors))
+            cache_clean(list_entry(list_front(&inode->dirty_sectors), 
+                                   struct cache_entry, dirty_elem), shut);
+    }
+    while (!list_empty(&filesys_cache.dirty_orphans))
+        cache_clean(list_entry(list_front(&filesys_cache.dirty_orphans), 
+                               struct cache_entry, dirty_elem), shut);
+    if (shut) {
+        cache_stopped = true;
+        workqueue_cancel(&cache_write_work);
+        block_drain();
+        /* Used for freeing the cache system */
+        curr = list_begin(&filesys_cache.cache_list);
+        while (curr && curr->next) {
+            next = list_next(curr);
             list_remove(curr);
+            curr = next;
         }
-        curr = next;
     }
     lock_release(&filesys_cache.cache_lock);
 }
 
-/* Main function for background write-behind */
-void cache_write_background(void *aux) {
-    while (true) {
-        /* Wait for 5 sec */
-        timer_sleep(CACHE_WRITE_TIME);
-        cache_write_to_disk(false);
-    }
+/* Work function for background write-behind, which queues itself again
+   to run CACHE_WRITE_TIME later, unless the cache has been shut down in
+   the meantime */
+void cache_write_background(void *aux UNUSED) {
+    cache_write_to_disk(false);
+    lock_acquire(&filesys_cache.cache_lock);
+    if (!cache_stopped)
+        workqueue_queue_delayed(&system_wq, &cache_write_work,
+                                CACHE_WRITE_TIME);
+    lock_release(&filesys_cache.cache_lock);
 }
 
-/* Main function for background read-ahead */
-void cache_read_ahead(void) {
-    while (true) {
-        sema_down(&read_ahead_lock);
-        if (just_read < fs_device->size) {
-            lock_acquire(&filesys_cache.cache_lock);
-            struct cache_entry *ahead = cache_readin(just_read + 1, false);
-            ahead->open_count--;
-            lock_release(&filesys_cache.cache_lock);
-        }
-    }
+/*! Completion callback for a read-ahead */
+static void cache_loaded(struct block_request *r) {
+    struct cache_entry *c = r->aux;
+
+    c->loading = false;
+    sema_up(&c->loaded);
 }
 
+/*! Start reading SECTOR into the cache without waiting for it, unless it
+    is already cached or lies past the end of the disk.  Until the read
+    finishes the block cannot be evicted, and cache_readin() waits for it.
+    The caller must hold the cache lock */
+static void cache_read_ahead(block_sector_t sector) {
+    struct cache_entry *ahead;
+
+    if (sector >= block_size(fs_device) || cache_find(sector) != NULL)
+        return;
+    ahead = cache_readin(sector, false);
+    ahead->open_count--;
+    ahead->loading = true;
+    sema_init(&ahead->loaded, 0);
+    block_request_init(&ahead->request, false, sector, ahead->cache_block, 1,
+                       cache_loaded, ahead);
+    block_submit(fs_device, &ahead->request);
+}
@@ -9,6 +9,8 @@
 #define CACHE_MAXSIZE 64                /* Allow maximum of 64 cache blocks */   
 #define CACHE_WRITE_TIME 5*TIMER_FREQ   /* Write dirty cache back every 5 sec */
 
+struct inode;
+
 /*! Cache entry
     Records necessary information for maintaining 1 cache block
  */
@@ -20,6 +22,12 @@ struct cache_entry {
     int open_count;                     /* Number of processes opening */
     bool accessed;                      /* Whether cache has been accessed */
     bool dirty;                         /* Whether cache is dirty */
+    struct inode *owner;                /* Inode that dirtied the block */
+    struct list_elem dirty_elem;        /* Element in owner's dirty list,
+                                           or in the orphan list */
+    volatile bool loading;              /* Contents still being filled in */
+    struct semaphore loaded;            /* Up'd when the fill finishes */
+    struct block_request request;       /* Read-ahead request */
 };
 
 /*! Cache system utility union
@@ -29,6 +37,8 @@ struct cache_system {
     struct lock cache_lock;             /* Global cache lock */
     uint32_t cache_count;               /* Number of cache blocks allocated */
     struct list_elem *evict_pointer;    /* For implementing clock algorithm */
+    struct list dirty_inodes;           /* Inodes with dirty cache blocks */
+    struct list dirty_orphans;          /* Dirty blocks without an open owner */
 };
 
 struct cache_system filesys_cache;
@@ -36,10 +46,14 @@ struct cache_system filesys_cache;
 void cache_init(void);
 struct cache_entry * cache_find(block_sector_t sector);
 struct cache_entry * cache_get(block_sector_t sector, bool dirty);
+struct cache_entry * cache_get_overwrite(block_sector_t sector,
+                                         const void *data);
 struct cache_entry * cache_evict(void);
+void cache_mark_dirty(struct cache_entry *c, struct inode *owner);
+void cache_flush_inode(struct inode *inode);
+void cache_release_inode(struct inode *inode, bool discard);
 
 void cache_write_to_disk(bool shut);
 void cache_write_background(void *aux);
-void cache_read_ahead(void);
 
 #endif
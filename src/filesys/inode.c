@@ -387,7 +387,11 @@ struct inode * inode_open(block_sector_t sector) {
     inode->open_cnt = 1;
     inode->deny_write_cnt = 0;
     inode->removed = false;
-    lock_init(&inode->lock);
+    lock_init_named(&inode->lock, "inode");
+    list_init(&inode->dirty_sectors);
+    inode->writebacks = 0;
+    inode->writeback_waiters = 0;
+    sema_init(&inode->writeback_done, 0);
     block_read(fs_device, inode->sector, &inode->data);
     inode->read_length = inode->data.length;
     return inode;
@@ -422,6 +426,10 @@ void inode_close(struct inode *inode) {
     if (--inode->open_cnt == 0) {
         /* Remove from inode list and release lock. */
         list_remove(&inode->elem);
+
+        /* Its dirty cache blocks outlive it, unless their sectors are about
+         * to be released. */
+        cache_release_inode(inode, inode->removed);
  
         /* Deallocate blocks if removed. */
         if (inode->removed) {
@@ -648,14 +656,19 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size,
             if (chunk_size <= 0)
                 break;
             
-            /* Cache in*/
-            c = cache_get(sector_idx, false);
-            /* Copy buffer to cache*/
-            memcpy((uint8_t *)&c->cache_block + sector_ofs, 
-                   buffer + bytes_written,
-                chunk_size);
+            /* Cache in; a whole-sector overwrite need not read the disk
+               and is filled by the cache itself */
+            if (chunk_size == BLOCK_SECTOR_SIZE)
+                c = cache_get_overwrite(sector_idx, buffer + bytes_written);
+            else {
+                c = cache_get(sector_idx, false);
+                /* Copy buffer to cache*/
+                memcpy((uint8_t *)&c->cache_block + sector_ofs, 
+                       buffer + bytes_written,
+                    chunk_size);
+            }
             
-            c->dirty = true;
+            cache_mark_dirty(c, inode);
             c->open_count--;
 
             /* Advance. */
@@ -694,14 +707,20 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size,
             /* Read the index data from the index sector*/
             block_read(fs_device, sector_idx, &block_i);
             
-            /* Cache in*/
-            c = cache_get(block_i[index_in_block], true);
-            /* Copy data from cache to buffer */
-            memcpy((uint8_t *)&c->cache_block + sector_ofs, 
-                   buffer + bytes_written,
-                chunk_size);
+            /* Cache in; a whole-sector overwrite need not read the disk
+               and is filled by the cache itself */
+            if (chunk_size == BLOCK_SECTOR_SIZE)
+                c = cache_get_overwrite(block_i[index_in_block],
+                                        buffer + bytes_written);
+            else {
+                c = cache_get(block_i[index_in_block], true);
+                /* Copy data from cache to buffer */
+                memcpy((uint8_t *)&c->cache_block + sector_ofs, 
+                       buffer + bytes_written,
+                    chunk_size);
+            }
             
-            c->dirty = true;
+            cache_mark_dirty(c, inode);
             c->open_count--;
             
             /* Advance. */
@@ -715,6 +734,110 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size,
     return bytes_written;
 }
 
+/*! Returns the data sector that holds byte OFFSET of INODE, which must
+    lie within the inode. */
+static block_sector_t inode_data_sector(struct inode *inode, off_t offset) {
+    /* Index sector data buffer */
+    block_sector_t block_i[MAX_BLOCKS + 1];
+    size_t index_in_block;
+
+    if (inode->data.type == NON_FILE_INODE_DISK)
+        return byte_to_sector(inode, offset);
+
+    /* Get the index of the sector in its corresponding index sector. */
+    if (offset % (BLOCK_SECTOR_SIZE * MAX_BLOCKS) == 0)
+        index_in_block = 0;
+    else
+        index_in_block = (bytes_to_sectors(offset + 1) - 1) % MAX_BLOCKS;
+
+    block_read(fs_device, inode_get_index_block(&inode->data, offset),
+               &block_i);
+    return block_i[index_in_block];
+}
+
+/*! Copies SIZE bytes from SRC, starting at SRC_OFS, into DST, starting at
+    DST_OFS, moving the data straight from one cache block to the other.
+    Destination sectors that are overwritten in full are never read from
+    disk.  Returns the number of bytes actually copied, which may be less
+    than SIZE if end of SRC is reached or DST cannot grow. */
+off_t inode_copy_at(struct inode *dst, off_t dst_ofs, struct inode *src,
+                    off_t src_ofs, off_t size) {
+    /* Bytes copied so far. */
+    off_t bytes_copied = 0;
+
+    /* Source and destination cache entries. */
+    struct cache_entry *s, *d;
+
+    /* Bytes of SRC that are ready for reading past SRC_OFS. */
+    off_t src_left = inode_length(src) < src->read_length ?
+                     inode_length(src) : src->read_length;
+    src_left -= src_ofs;
+
+    if (dst->deny_write_cnt || src_left <= 0 || size <= 0)
+        return 0;
+    if (size > src_left)
+        size = src_left;
+
+    /* lock the inode for extending the file*/
+    if (inode_length(dst) < dst_ofs + size) {
+        lock_acquire(&dst->lock);
+        if (inode_length(dst) < dst_ofs + size &&
+            !inode_extend(dst, dst_ofs + size)) {
+            lock_release(&dst->lock);
+            return 0;
+        }
+        lock_release(&dst->lock);
+    }
+
+    while (size > 0) {
+        /* Starting byte offsets within the two sectors. */
+        int src_sector_ofs = src_ofs % BLOCK_SECTOR_SIZE;
+        int dst_sector_ofs = dst_ofs % BLOCK_SECTOR_SIZE;
+
+        /* Copy up to the nearer of the two sector ends. */
+        int chunk_size = BLOCK_SECTOR_SIZE -
+            (src_sector_ofs > dst_sector_ofs ? src_sector_ofs
+                                             : dst_sector_ofs);
+        if (size < chunk_size)
+            chunk_size = size;
+
+        s = cache_get(inode_data_sector(src, src_ofs), false);
+        if (chunk_size == BLOCK_SECTOR_SIZE)
+            d = cache_get_overwrite(inode_data_sector(dst, dst_ofs),
+                                    s->cache_block);
+        else {
+            d = cache_get(inode_data_sector(dst, dst_ofs), true);
+            /* The two ranges may share a sector when copying within a
+               file. */
+            memmove((uint8_t *)&d->cache_block + dst_sector_ofs,
+                    (uint8_t *)&s->cache_block + src_sector_ofs, chunk_size);
+        }
+
+        cache_mark_dirty(d, dst);
+        d->open_count--;
+        s->open_count--;
+
+        /* Advance. */
+        size -= chunk_size;
+        src_ofs += chunk_size;
+        dst_ofs += chunk_size;
+        bytes_copied += chunk_size;
+        dst->read_length += chunk_size;
+    }
+
+    return bytes_copied;
+}
+
+/*! Writes INODE's dirty cached data back to disk, followed by the on-disk
+    inode itself unless DATA_ONLY is set.  Index sectors and the inode's
+    length are written through whenever the inode grows, so DATA_ONLY is
+    enough to make the contents retrievable. */
+void inode_sync(struct inode *inode, bool data_only) {
+    cache_flush_inode(inode);
+    if (!data_only)
+        block_write(fs_device, inode->sector, &inode->data);
+}
+
 /*! Disables writes to INODE.
     May be called at most once per inode opener. */
 void inode_deny_write (struct inode *inode) {
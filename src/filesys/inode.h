@@ -31,6 +31,14 @@ struct inode {
     struct inode_disk data;             /*!< Inode content. */
     struct lock lock;                   /*!< Lock. */
     off_t read_length;                  /*!< Length ready for reading. */
+    struct list dirty_sectors;          /*!< Dirty cache blocks of the inode. */
+    struct list_elem dirty_elem;        /*!< Element in the cache's list of
+                                             dirty inodes. */
+    int writebacks;                     /*!< Write-backs of its blocks still
+                                             on their way to disk. */
+    int writeback_waiters;              /*!< Threads waiting for them. */
+    struct semaphore writeback_done;    /*!< Up'd once per waiter when the
+                                             last of them completes. */
 };
 
 struct bitmap;
@@ -45,9 +53,12 @@ void inode_close(struct inode *);
 void inode_remove(struct inode *);
 off_t inode_read_at(struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at(struct inode *, const void *, off_t size, off_t offset);
+off_t inode_copy_at(struct inode *dst, off_t dst_ofs, struct inode *src,
+                    off_t src_ofs, off_t size);
 void inode_deny_write(struct inode *);
 void inode_allow_write(struct inode *);
 off_t inode_length(const struct inode *);
+void inode_sync(struct inode *, bool data_only);
 bool inode_alloc_block(struct inode_disk* head, off_t length);
 block_sector_t inode_get_index_block(struct inode_disk* head, off_t length);
 #endif /* filesys/inode.h */
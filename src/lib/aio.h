@@ -0,0 +1,61 @@
+/*! \file aio.h
+ *
+ * Layout of the asynchronous I/O rings shared between a user process and
+ * the kernel.  A process maps one ring page with aio_setup(), fills
+ * submission entries and advances sq_tail, then calls aio_enter() to hand
+ * them to the kernel.  Kernel workers perform the I/O and post completion
+ * entries by advancing cq_tail, which the process can reap without a trap
+ * by reading entries up to cq_tail and advancing cq_head.
+ *
+ * Ring indices run freely and are reduced modulo the ring size only when
+ * an entry is addressed.
+ */
+
+#ifndef __LIB_AIO_H
+#define __LIB_AIO_H
+
+#include <stdint.h>
+
+/*! Number of entries in the submission and completion rings.  Both must be
+    powers of 2. */
+#define AIO_SQ_ENTRIES 64
+#define AIO_CQ_ENTRIES 128
+
+/*! Largest buffer accepted by a single read or write operation. */
+#define AIO_MAX_LEN (64 * 1024)
+
+/*! Operation codes for aio_sqe.opcode. */
+enum aio_opcode {
+    AIO_OP_NOP,                 /*!< Complete immediately with result 0. */
+    AIO_OP_READ,                /*!< Read from a file at an offset. */
+    AIO_OP_WRITE                /*!< Write to a file at an offset. */
+};
+
+/*! Submission entry, filled in by the process. */
+struct aio_sqe {
+    uint32_t opcode;            /*!< One of enum aio_opcode. */
+    int32_t fd;                 /*!< File descriptor to operate on. */
+    uint32_t offset;            /*!< Byte offset within the file. */
+    uint32_t len;               /*!< Length of the buffer in bytes. */
+    void *buf;                  /*!< User buffer. */
+    uint32_t user_data;         /*!< Copied unchanged into the completion. */
+};
+
+/*! Completion entry, filled in by the kernel. */
+struct aio_cqe {
+    uint32_t user_data;         /*!< user_data of the finished submission. */
+    int32_t res;                /*!< Bytes transferred, or -1 on error. */
+};
+
+/*! The shared ring page. */
+struct aio_ring {
+    volatile uint32_t sq_head;  /*!< Next submission the kernel consumes. */
+    volatile uint32_t sq_tail;  /*!< Next free submission slot (process). */
+    volatile uint32_t cq_head;  /*!< Next completion to reap (process). */
+    volatile uint32_t cq_tail;  /*!< Next completion slot (kernel). */
+    struct aio_sqe sqes[AIO_SQ_ENTRIES];
+    struct aio_cqe cqes[AIO_CQ_ENTRIES];
+};
+
+#endif /* lib/aio.h */
+
@@ -0,0 +1,52 @@
+/*! \file blkstat.h
+ *
+ * Per-device block I/O statistics, as kept by the kernel and returned to
+ * user programs by the blkstat() system call.  Each Pintos role (file
+ * system, swap, scratch) lives on its own block device or partition, so
+ * the statistics of a role's device describe that caller's I/O alone.
+ * The disk underneath a partition sees the I/O of every role on it.
+ */
+
+#ifndef __LIB_BLKSTAT_H
+#define __LIB_BLKSTAT_H
+
+#include <stdint.h>
+
+/*! Number of latency histogram buckets.  Bucket 0 counts requests that
+    took under 2 us, bucket I > 0 those that took from 2**I up to
+    2**(I+1) us, and the last bucket everything slower. */
+#define BLKSTAT_BUCKETS 24
+
+/*! Indexes into blkstat.dir. */
+enum blkstat_direction {
+    BLKSTAT_READ,               /*!< Reads. */
+    BLKSTAT_WRITE,              /*!< Writes. */
+    BLKSTAT_DIRS
+};
+
+/*! Statistics for one direction of transfer. */
+struct blkstat_dir {
+    uint64_t ops;               /*!< Requests completed. */
+    uint64_t bytes;             /*!< Bytes transferred. */
+    uint64_t sequential;        /*!< Requests starting where the device's
+                                     previous request ended. */
+    uint64_t total_us;          /*!< Sum of submit-to-completion times. */
+    uint64_t max_us;            /*!< Longest submit-to-completion time. */
+    uint32_t hist[BLKSTAT_BUCKETS];     /*!< Log2 latency histogram. */
+};
+
+/*! Statistics for one block device. */
+struct blkstat {
+    char name[16];              /*!< Device name, e.g. "hda1". */
+    char role[16];              /*!< Role, e.g. "filesys" or "raw". */
+    uint32_t size;              /*!< Size in sectors. */
+    uint32_t max_depth;         /*!< Most requests ever queued at once. */
+    uint64_t depth_sum;         /*!< Sum of queue depths seen by
+                                     submissions, for the average. */
+    uint64_t submits;           /*!< Submissions to the device's own queue;
+                                     0 for partitions, which pass requests
+                                     to their disk. */
+    struct blkstat_dir dir[BLKSTAT_DIRS];   /*!< Indexed by direction. */
+};
+
+#endif /* lib/blkstat.h */
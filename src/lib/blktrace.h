@@ -0,0 +1,56 @@
+/*! \file blktrace.h
+ *
+ * On-disk layout of a block I/O trace.  When the kernel is started with
+ * -blktrace it records every request submitted to a block device and,
+ * at shutdown, writes the most recent ones to the scratch device: a
+ * header in the first sector, then the entries, oldest first, packed from
+ * the second sector on.  utils/blktrace reads and summarizes them.
+ *
+ * All fields are little-endian.
+ */
+
+#ifndef __LIB_BLKTRACE_H
+#define __LIB_BLKTRACE_H
+
+#include <stdint.h>
+
+/*! Identifies a trace header. */
+#define BLKTRACE_MAGIC "BLKTRACE"
+#define BLKTRACE_VERSION 1
+
+/*! Most devices described in a header. */
+#define BLKTRACE_MAX_DEVS 16
+
+/*! Entry flags. @{ */
+#define BLKTRACE_WRITE 0x01     /*!< Write, rather than read. */
+#define BLKTRACE_SYNC 0x02      /*!< Submitter waited for completion. */
+/*! @} */
+
+/*! A block device, as known at shutdown. */
+struct blktrace_dev {
+    char name[16];              /*!< Name, e.g. "hda1". */
+    uint32_t type;              /*!< enum block_type: 0=kernel, 1=filesys,
+                                     2=scratch, 3=swap, 4=raw, 5=foreign. */
+    uint32_t size;              /*!< Size in sectors. */
+};
+
+/*! The first sector of a trace. */
+struct blktrace_header {
+    char magic[8];              /*!< BLKTRACE_MAGIC, not null-terminated. */
+    uint32_t version;           /*!< BLKTRACE_VERSION. */
+    uint32_t entry_cnt;         /*!< Entries that follow. */
+    uint32_t lost;              /*!< Older entries overwritten or cut. */
+    uint32_t dev_cnt;           /*!< Entries used in DEVS. */
+    struct blktrace_dev devs[BLKTRACE_MAX_DEVS];
+};
+
+/*! One request, as first submitted. */
+struct blktrace_entry {
+    uint32_t time_us;           /*!< Microseconds since boot. */
+    uint32_t sector;            /*!< First sector, within DEV. */
+    uint16_t cnt;               /*!< Number of sectors. */
+    uint8_t dev;                /*!< Index into blktrace_header.devs. */
+    uint8_t flags;              /*!< BLKTRACE_* flags. */
+};
+
+#endif /* lib/blktrace.h */
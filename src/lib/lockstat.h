@@ -0,0 +1,26 @@
+/*! \file lockstat.h
+ *
+ * Lock contention statistics, as kept by the kernel when started with
+ * -lockstat and returned to user programs by the lockstat() system call.
+ * Statistics are kept per lock name, so every lock initialized with the
+ * same name, such as the locks of all open inodes, adds to one entry.
+ */
+
+#ifndef __LIB_LOCKSTAT_H
+#define __LIB_LOCKSTAT_H
+
+#include <stdint.h>
+
+/*! Statistics for the locks sharing one name. */
+struct lockstat {
+    char name[24];              /*!< Name given at lock initialization. */
+    uint32_t locks;             /*!< Number of locks initialized with it. */
+    uint64_t acquisitions;      /*!< Successful lock_acquire() calls. */
+    uint64_t contended;         /*!< Acquisitions that had to wait. */
+    uint64_t wait_total_us;     /*!< Sum of the waits. */
+    uint64_t wait_max_us;       /*!< Longest wait. */
+    uint64_t hold_total_us;     /*!< Sum of acquire-to-release times. */
+    uint64_t hold_max_us;       /*!< Longest hold. */
+};
+
+#endif /* lib/lockstat.h */
@@ -0,0 +1,62 @@
+/*! \file schedtrace.h
+ *
+ * On-disk layout of a scheduler trace.  When the kernel is started with
+ * -schedtrace it records every context switch and every wakeup and, at
+ * shutdown, writes the most recent ones to the scratch device: a header
+ * in the first sector, then the entries, oldest first, from the second
+ * sector on.  Each sector holds SCHEDTRACE_PER_SECTOR whole entries
+ * followed by padding.  utils/schedtrace reads and summarizes them.
+ *
+ * All fields are little-endian.
+ */
+
+#ifndef __LIB_SCHEDTRACE_H
+#define __LIB_SCHEDTRACE_H
+
+#include <stdint.h>
+
+/*! Identifies a trace header. */
+#define SCHEDTRACE_MAGIC "SCHEDTRC"
+#define SCHEDTRACE_VERSION 1
+
+/*! Entry types. @{ */
+#define SCHEDTRACE_WAKEUP 0     /*!< A blocked thread became ready. */
+#define SCHEDTRACE_SWITCH 1     /*!< The CPU switched threads. */
+/*! @} */
+
+/*! Why the previous thread gave up the CPU, for SCHEDTRACE_SWITCH.  @{ */
+#define SCHEDTRACE_YIELD 0      /*!< Called thread_yield(); still ready. */
+#define SCHEDTRACE_BLOCK 1      /*!< Blocked. */
+#define SCHEDTRACE_PREEMPT 2    /*!< Time slice ran out or a higher
+                                     priority thread became ready. */
+#define SCHEDTRACE_EXIT 3       /*!< Exited. */
+/*! @} */
+
+/*! The first sector of a trace. */
+struct schedtrace_header {
+    char magic[8];              /*!< SCHEDTRACE_MAGIC, not null-terminated. */
+    uint32_t version;           /*!< SCHEDTRACE_VERSION. */
+    uint32_t entry_cnt;         /*!< Entries that follow. */
+    uint32_t lost;              /*!< Older entries overwritten or cut. */
+    uint32_t cpu_cnt;           /*!< Number of CPUs traced. */
+    uint64_t cycles_per_sec;    /*!< Rate of the TSC timestamps. */
+    int32_t idle_tid;           /*!< Tid of the idle thread. */
+};
+
+/*! One event. */
+struct schedtrace_entry {
+    uint64_t tsc;               /*!< Time-stamp counter. */
+    int32_t tid;                /*!< Thread woken, or previous thread. */
+    int32_t next_tid;           /*!< Next thread, for SCHEDTRACE_SWITCH. */
+    uint8_t type;               /*!< SCHEDTRACE_WAKEUP or _SWITCH. */
+    uint8_t reason;             /*!< SCHEDTRACE_YIELD etc., for a switch. */
+    uint8_t priority;           /*!< Effective priority of TID. */
+    uint8_t next_priority;      /*!< Effective priority of NEXT_TID. */
+    uint16_t ready_cnt;         /*!< Threads on the run queue afterward. */
+    uint16_t cpu;               /*!< CPU the event happened on. */
+};
+
+/*! Entries stored in each sector after the header. */
+#define SCHEDTRACE_PER_SECTOR (512 / sizeof (struct schedtrace_entry))
+
+#endif /* lib/schedtrace.h */
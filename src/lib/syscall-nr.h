@@ -34,7 +34,35 @@ enum {
     SYS_MKDIR,                  /*!< Create a directory. */
     SYS_READDIR,                /*!< Reads a directory entry. */
     SYS_ISDIR,                  /*!< Tests if a fd represents a directory. */
-    SYS_INUMBER                 /*!< Returns the inode number for a fd. */
+    SYS_INUMBER,                /*!< Returns the inode number for a fd. */
+
+    /* Positioned and scatter/gather I/O. */
+    SYS_PREAD,                  /*!< Read from a file at an offset. */
+    SYS_PWRITE,                 /*!< Write to a file at an offset. */
+    SYS_READV,                  /*!< Read from a file into several buffers. */
+    SYS_WRITEV,                 /*!< Write to a file from several buffers. */
+    SYS_COPY_FILE_RANGE,        /*!< Copy data between two files. */
+
+    /* Asynchronous I/O. */
+    SYS_AIO_SETUP,              /*!< Map the submission/completion rings. */
+    SYS_AIO_ENTER,              /*!< Submit and wait for completions. */
+
+    /* Durability. */
+    SYS_FSYNC,                  /*!< Write a file's data and inode to disk. */
+    SYS_FDATASYNC,              /*!< Write a file's data to disk. */
+
+    /* Statistics. */
+    SYS_BLKSTAT,                /*!< Read a block device's I/O statistics. */
+    SYS_LOCKSTAT,               /*!< Read lock contention statistics. */
+
+    /* Synchronization. */
+    SYS_FUTEX_WAIT,             /*!< Sleep while a user word is unchanged. */
+    SYS_FUTEX_WAKE,             /*!< Wake sleepers on a user word. */
+
+    /* Threads. */
+    SYS_THREAD_CREATE,          /*!< Start another thread in the process. */
+    SYS_THREAD_JOIN,            /*!< Wait for a thread to end. */
+    SYS_THREAD_EXIT             /*!< End the current thread. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,111 @@
+/*! \file synch.c
+ *
+ * The mutex follows the third algorithm of Drepper, "Futexes Are Tricky":
+ * a locker that finds the mutex taken marks it contended before sleeping,
+ * so that only an unlock that sees the mark has to call futex_wake().
+ */
+
+#include <synch.h>
+#include <limits.h>
+#include <syscall.h>
+
+/*! Atomically replaces *P by NEW if it equals OLD.  Returns the value *P
+    had before. */
+static inline int cmpxchg(int *p, int old, int new) {
+    int prev;
+    asm volatile ("lock cmpxchgl %2, %1"
+                  : "=a" (prev), "+m" (*p) : "r" (new), "0" (old)
+                  : "memory");
+    return prev;
+}
+
+/*! Atomically stores NEW in *P and returns its old value. */
+static inline int xchg(int *p, int new) {
+    asm volatile ("xchgl %0, %1" : "+r" (new), "+m" (*p) : : "memory");
+    return new;
+}
+
+/*! Atomically adds DELTA to *P and returns its old value. */
+static inline int fetch_add(int *p, int delta) {
+    asm volatile ("lock xaddl %0, %1" : "+r" (delta), "+m" (*p) : : "memory");
+    return delta;
+}
+
+/*! Initializes M, which is initially unlocked. */
+void mutex_init(struct mutex *m) {
+    m->state = 0;
+}
+
+/*! Acquires M, sleeping until it is available if necessary. */
+void mutex_lock(struct mutex *m) {
+    int c = cmpxchg(&m->state, 0, 1);
+
+    if (c == 0)
+        return;
+
+    /* Contended.  Mark it so, then sleep until an unlock finds the mark
+       and wakes us.  Whoever gets it this way keeps the mark, since other
+       threads may still be sleeping. */
+    if (c != 2)
+        c = xchg(&m->state, 2);
+    while (c != 0) {
+        futex_wait(&m->state, 2);
+        c = xchg(&m->state, 2);
+    }
+}
+
+/*! Acquires M if it is available without sleeping.  Returns nonzero on
+    success, zero if M was held. */
+int mutex_trylock(struct mutex *m) {
+    return cmpxchg(&m->state, 0, 1) == 0;
+}
+
+/*! Releases M, which the caller must hold, waking a sleeper if there may
+    be one. */
+void mutex_unlock(struct mutex *m) {
+    if (fetch_add(&m->state, -1) != 1) {
+        m->state = 0;
+        futex_wake(&m->state, 1);
+    }
+}
+
+/*! Initializes CV. */
+void condvar_init(struct condvar *cv) {
+    cv->seq = 0;
+    cv->waiters = 0;
+}
+
+/*! Atomically releases M, which the caller must hold, and waits for CV to
+    be signalled, then reacquires M.  As with any condition variable, the
+    caller must recheck its condition afterward. */
+void condvar_wait(struct condvar *cv, struct mutex *m) {
+    int seq = cv->seq;
+
+    fetch_add(&cv->waiters, 1);
+    mutex_unlock(m);
+
+    /* Returns at once if a signal bumped SEQ since we read it. */
+    futex_wait(&cv->seq, seq);
+    fetch_add(&cv->waiters, -1);
+
+    /* Other threads woken with us may be sleeping on M by now, so take it
+       as contended, or their wakeup could be lost at our unlock. */
+    while (xchg(&m->state, 2) != 0)
+        futex_wait(&m->state, 2);
+}
+
+/*! Wakes one thread waiting on CV, if any. */
+void condvar_signal(struct condvar *cv) {
+    if (cv->waiters == 0)
+        return;
+    fetch_add(&cv->seq, 1);
+    futex_wake(&cv->seq, 1);
+}
+
+/*! Wakes every thread waiting on CV. */
+void condvar_broadcast(struct condvar *cv) {
+    if (cv->waiters == 0)
+        return;
+    fetch_add(&cv->seq, 1);
+    futex_wake(&cv->seq, INT_MAX);
+}
@@ -0,0 +1,39 @@
+/*! \file synch.h
+ *
+ * User-space mutex and condition variable built on futex_wait() and
+ * futex_wake().  Both live entirely in user memory and only make a system
+ * call when a thread has to sleep or there is a sleeper to wake.
+ */
+
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+/*! Mutex.  0 is unlocked, 1 locked without sleepers, 2 locked with
+    possible sleepers. */
+struct mutex {
+    int state;
+};
+
+/*! Initializer for a statically allocated mutex. */
+#define MUTEX_INITIALIZER { 0 }
+
+void mutex_init(struct mutex *);
+void mutex_lock(struct mutex *);
+int mutex_trylock(struct mutex *);
+void mutex_unlock(struct mutex *);
+
+/*! Condition variable. */
+struct condvar {
+    int seq;                    /*!< Bumped by every signal. */
+    int waiters;                /*!< Threads in condvar_wait(). */
+};
+
+/*! Initializer for a statically allocated condition variable. */
+#define CONDVAR_INITIALIZER { 0, 0 }
+
+void condvar_init(struct condvar *);
+void condvar_wait(struct condvar *, struct mutex *);
+void condvar_signal(struct condvar *);
+void condvar_broadcast(struct condvar *);
+
+#endif /* lib/user/synch.h */
@@ -1,11 +1,10 @@
 /*! \file syscall.c
  *
  * User-space wrappers for invoking system calls through the standard UNIX
- * APIs.  Four macros are defined, syscall0(), syscall1(), syscall2(), and
- * syscall3(), to pass the corresponding number of arguments to the system
- * call being invoked.  The remaining functions are wrappers for standard
- * UNIX operations, which simply use the syscall macros to invoke the
- * system call.
+ * APIs.  Five macros are defined, syscall0() through syscall4(), to pass
+ * the corresponding number of arguments to the system call being invoked.
+ * The remaining functions are wrappers for standard UNIX operations, which
+ * simply use the syscall macros to invoke the system call.
  */
 
 #include <syscall.h>
@@ -71,6 +70,25 @@
           retval;                                               \
         })
 
+/*! Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2, and
+    ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; "    \
+             "pushl %[arg0]; pushl %[number]; int $0x30; "      \
+             "addl $20, %%esp"                                  \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "r" (ARG0),                             \
+                 [arg1] "r" (ARG1),                             \
+                 [arg2] "r" (ARG2),                             \
+                 [arg3] "r" (ARG3)                              \
+               : "memory");                                     \
+          retval;                                               \
+        })
+
 void halt(void) {
     syscall0(SYS_HALT);
     NOT_REACHED();
@@ -153,3 +171,72 @@ int inumber(int fd) {
     return syscall1(SYS_INUMBER, fd);
 }
 
+int pread(int fd, void *buffer, unsigned size, unsigned offset) {
+    return syscall4(SYS_PREAD, fd, buffer, size, offset);
+}
+
+int pwrite(int fd, const void *buffer, unsigned size, unsigned offset) {
+    return syscall4(SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int readv(int fd, const struct iovec *iov, int iovcnt) {
+    return syscall3(SYS_READV, fd, iov, iovcnt);
+}
+
+int writev(int fd, const struct iovec *iov, int iovcnt) {
+    return syscall3(SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int copy_file_range(int fd_in, int fd_out, unsigned length) {
+    return syscall3(SYS_COPY_FILE_RANGE, fd_in, fd_out, length);
+}
+
+bool aio_setup(struct aio_ring *ring) {
+    return syscall1(SYS_AIO_SETUP, ring);
+}
+
+int aio_enter(unsigned to_submit, unsigned min_complete) {
+    return syscall2(SYS_AIO_ENTER, to_submit, min_complete);
+}
+
+bool fsync(int fd) {
+    return syscall1(SYS_FSYNC, fd);
+}
+
+bool fdatasync(int fd) {
+    return syscall1(SYS_FDATASYNC, fd);
+}
+
+bool blkstat(unsigned index, struct blkstat *stats) {
+    return syscall2(SYS_BLKSTAT, index, stats);
+}
+
+bool lockstat(unsigned index, struct lockstat *stats) {
+    return syscall2(SYS_LOCKSTAT, index, stats);
+}
+
+int futex_wait(int *addr, int expected) {
+    return syscall2(SYS_FUTEX_WAIT, addr, expected);
+}
+
+int futex_wake(int *addr, int cnt) {
+    return syscall2(SYS_FUTEX_WAKE, addr, cnt);
+}
+
+/* Where every thread made by thread_create() starts. */
+static void thread_start(thread_func *func, void *aux) {
+    thread_exit(func(aux));
+}
+
+tid_t thread_create(thread_func *func, void *aux) {
+    return syscall3(SYS_THREAD_CREATE, thread_start, func, aux);
+}
+
+int thread_join(tid_t tid) {
+    return syscall1(SYS_THREAD_JOIN, tid);
+}
+
+void thread_exit(int status) {
+    syscall1(SYS_THREAD_EXIT, status);
+    NOT_REACHED();
+}
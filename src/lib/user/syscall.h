@@ -2,6 +2,9 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <aio.h>
+#include <blkstat.h>
+#include <lockstat.h>
 #include <debug.h>
 
 /*! Process identifier. */
@@ -15,6 +18,15 @@ typedef int mapid_t;
 /*! Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
+/*! Maximum number of buffers accepted by readv() and writev(). */
+#define IOV_MAX 64
+
+/*! One buffer of a readv() or writev() request. */
+struct iovec {
+    void *iov_base;             /*!< Start of the buffer. */
+    unsigned iov_len;           /*!< Length of the buffer in bytes. */
+};
+
 /*! Typical return values from main() and arguments to exit(). */
 #define EXIT_SUCCESS 0          /*!< Successful execution. */
 #define EXIT_FAILURE 1          /*!< Unsuccessful execution. */
@@ -45,5 +57,39 @@ bool readdir(int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir(int fd);
 int inumber(int fd);
 
+/* Positioned and scatter/gather I/O. */
+int pread(int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite(int fd, const void *buffer, unsigned length, unsigned offset);
+int readv(int fd, const struct iovec *iov, int iovcnt);
+int writev(int fd, const struct iovec *iov, int iovcnt);
+int copy_file_range(int fd_in, int fd_out, unsigned length);
+
+/* Asynchronous I/O. */
+bool aio_setup(struct aio_ring *ring);
+int aio_enter(unsigned to_submit, unsigned min_complete);
+
+/* Durability. */
+bool fsync(int fd);
+bool fdatasync(int fd);
+
+/* Statistics. */
+bool blkstat(unsigned index, struct blkstat *stats);
+bool lockstat(unsigned index, struct lockstat *stats);
+
+/* Synchronization.  See lib/user/synch.h for locks built on these. */
+int futex_wait(int *addr, int expected);
+int futex_wake(int *addr, int cnt);
+
+/* Threads.  A thread runs FUNC(AUX) on a stack of its own and shares
+   everything else with the rest of the process.  Returning from FUNC
+   ends the thread like thread_exit() with the value returned. */
+typedef int tid_t;
+#define TID_ERROR ((tid_t) -1)
+typedef int thread_func(void *aux);
+
+tid_t thread_create(thread_func *func, void *aux);
+int thread_join(tid_t);
+void thread_exit(int status) NO_RETURN;
+
 #endif /* lib/user/syscall.h */
 
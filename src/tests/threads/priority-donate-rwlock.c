@@ -0,0 +1,70 @@
+/* The main thread and a reader thread both hold a reader-writer
+   lock for reading, and the reader then blocks on a semaphore.
+   A high-priority writer waits for the lock, donating its
+   priority to both readers.  The main thread ups the semaphore
+   and releases its read lock, dropping back to its own priority,
+   so the reader runs with the donated priority.  When the reader
+   releases the lock, the writer gets it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct rwlock_and_sema 
+  {
+    struct rwlock rwlock;
+    struct semaphore sema;
+  };
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_priority_donate_rwlock (void) 
+{
+  struct rwlock_and_sema rs;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rs.rwlock);
+  sema_init (&rs.sema, 0);
+  rwlock_acquire_read (&rs.rwlock);
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread_func, &rs);
+  thread_create ("writer", PRI_DEFAULT + 5, writer_thread_func, &rs);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+  sema_up (&rs.sema);
+  rwlock_release_read (&rs.rwlock);
+  msg ("Main thread finished.");
+}
+
+static void
+reader_thread_func (void *rs_) 
+{
+  struct rwlock_and_sema *rs = rs_;
+
+  rwlock_acquire_read (&rs->rwlock);
+  msg ("Reader acquired read lock.");
+  sema_down (&rs->sema);
+  msg ("Reader should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+  rwlock_release_read (&rs->rwlock);
+  msg ("Reader finished.");
+}
+
+static void
+writer_thread_func (void *rs_) 
+{
+  struct rwlock_and_sema *rs = rs_;
+
+  rwlock_acquire_write (&rs->rwlock);
+  msg ("Writer acquired write lock.");
+  rwlock_release_write (&rs->rwlock);
+  msg ("Writer finished.");
+}
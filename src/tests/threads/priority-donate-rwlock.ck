@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-rwlock) begin
+(priority-donate-rwlock) Reader acquired read lock.
+(priority-donate-rwlock) Main thread should have priority 36.  Actual priority: 36.
+(priority-donate-rwlock) Reader should have priority 36.  Actual priority: 36.
+(priority-donate-rwlock) Writer acquired write lock.
+(priority-donate-rwlock) Writer finished.
+(priority-donate-rwlock) Reader finished.
+(priority-donate-rwlock) Main thread finished.
+(priority-donate-rwlock) end
+EOF
+pass;
@@ -0,0 +1,60 @@
+/* The main thread holds a reader-writer lock for reading while a
+   higher-priority reader acquires it too, then a writer has to
+   wait for the main thread's release.  Then the main thread holds
+   the lock for writing, and a reader has to wait for it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_basic (void) 
+{
+  struct rwlock rw;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+  rwlock_acquire_read (&rw);
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread_func, &rw);
+  thread_create ("writer", PRI_DEFAULT + 2, writer_thread_func, &rw);
+  msg ("Writer must wait for main thread to release read lock.");
+  rwlock_release_read (&rw);
+
+  rwlock_acquire_write (&rw);
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread_func, &rw);
+  msg ("Reader must wait for main thread to release write lock.");
+  rwlock_release_write (&rw);
+  msg ("Main thread finished.");
+}
+
+static void
+reader_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_read (rw);
+  msg ("Reader acquired read lock.");
+  rwlock_release_read (rw);
+  msg ("Reader done.");
+}
+
+static void
+writer_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_write (rw);
+  msg ("Writer acquired write lock.");
+  rwlock_release_write (rw);
+  msg ("Writer done.");
+}
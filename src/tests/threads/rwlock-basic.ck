@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-basic) begin
+(rwlock-basic) Reader acquired read lock.
+(rwlock-basic) Reader done.
+(rwlock-basic) Writer must wait for main thread to release read lock.
+(rwlock-basic) Writer acquired write lock.
+(rwlock-basic) Writer done.
+(rwlock-basic) Reader must wait for main thread to release write lock.
+(rwlock-basic) Reader acquired read lock.
+(rwlock-basic) Reader done.
+(rwlock-basic) Main thread finished.
+(rwlock-basic) end
+EOF
+pass;
@@ -0,0 +1,128 @@
+/* Contention benchmark for reader-writer locks.  READERS threads
+   repeatedly read a pair of counters that WRITERS threads update,
+   each sleeping for a tick inside its critical section as if it
+   were waiting for I/O.  The same workload runs once with a
+   reader-writer lock and once with a plain lock, and the elapsed
+   ticks of each are printed.  Readers must never see a write half
+   done. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READERS 8
+#define WRITERS 2
+#define ITERS 10
+
+struct shared 
+  {
+    bool use_rwlock;            /* Use RWLOCK, or else LOCK? */
+    struct rwlock rwlock;
+    struct lock lock;
+    int first, second;          /* Always equal outside a write. */
+    int torn_reads;             /* Reads that saw them differ. */
+    struct semaphore done;      /* Upped by each thread as it exits. */
+  };
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+static int64_t
+run (struct shared *s, bool use_rwlock) 
+{
+  int64_t start;
+  int i;
+
+  s->use_rwlock = use_rwlock;
+  rwlock_init (&s->rwlock);
+  lock_init (&s->lock);
+  s->first = s->second = 0;
+  sema_init (&s->done, 0);
+
+  start = timer_ticks ();
+  for (i = 0; i < READERS; i++)
+    thread_create ("reader", PRI_DEFAULT, reader_thread_func, s);
+  for (i = 0; i < WRITERS; i++)
+    thread_create ("writer", PRI_DEFAULT, writer_thread_func, s);
+  for (i = 0; i < READERS + WRITERS; i++)
+    sema_down (&s->done);
+
+  if (s->first != WRITERS * ITERS || s->second != WRITERS * ITERS)
+    fail ("counters are %d and %d, expected %d",
+          s->first, s->second, WRITERS * ITERS);
+  return timer_elapsed (start);
+}
+
+void
+test_rwlock_bench (void) 
+{
+  struct shared s;
+  int64_t rwlock_ticks, lock_ticks;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  s.torn_reads = 0;
+  rwlock_ticks = run (&s, true);
+  lock_ticks = run (&s, false);
+  if (s.torn_reads != 0)
+    fail ("%d reads saw a write half done", s.torn_reads);
+
+  msg ("%d reads and %d writes per run.",
+       READERS * ITERS, WRITERS * ITERS);
+  msg ("rwlock: %lld ticks.", rwlock_ticks);
+  msg ("lock: %lld ticks.", lock_ticks);
+}
+
+static void
+reader_thread_func (void *s_) 
+{
+  struct shared *s = s_;
+  int i;
+
+  for (i = 0; i < ITERS; i++) 
+    {
+      if (s->use_rwlock)
+        rwlock_acquire_read (&s->rwlock);
+      else
+        lock_acquire (&s->lock);
+
+      timer_sleep (1);
+      if (s->first != s->second)
+        s->torn_reads++;
+
+      if (s->use_rwlock)
+        rwlock_release_read (&s->rwlock);
+      else
+        lock_release (&s->lock);
+    }
+  sema_up (&s->done);
+}
+
+static void
+writer_thread_func (void *s_) 
+{
+  struct shared *s = s_;
+  int i;
+
+  for (i = 0; i < ITERS; i++) 
+    {
+      if (s->use_rwlock)
+        rwlock_acquire_write (&s->rwlock);
+      else
+        lock_acquire (&s->lock);
+
+      s->first++;
+      timer_sleep (1);
+      s->second++;
+
+      if (s->use_rwlock)
+        rwlock_release_write (&s->rwlock);
+      else
+        lock_release (&s->lock);
+    }
+  sema_up (&s->done);
+}
@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my ($rwlock_ticks, $lock_ticks);
+foreach (@output) {
+    fail "$_\n" if /FAIL/;
+    $rwlock_ticks = $1 if /^\(rwlock-bench\) rwlock: (\d+) ticks\.$/;
+    $lock_ticks = $1 if /^\(rwlock-bench\) lock: (\d+) ticks\.$/;
+}
+fail "missing rwlock timing\n" if !defined $rwlock_ticks;
+fail "missing lock timing\n" if !defined $lock_ticks;
+
+# Readers overlap their sleeps only under the reader-writer lock.
+fail "rwlock run ($rwlock_ticks ticks) was no faster than "
+  . "lock run ($lock_ticks ticks)\n"
+  if $rwlock_ticks >= $lock_ticks;
+pass;
@@ -0,0 +1,60 @@
+/* The main thread holds a reader-writer lock for reading.  A
+   writer starts waiting for it, and then a reader of even higher
+   priority asks to read.  Although the lock is only held for
+   reading, the reader must queue behind the writer, and the
+   reader's priority is donated to the writer once the writer
+   holds the lock.  The reader gets the lock when the writer
+   releases it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_writer_pref (void) 
+{
+  struct rwlock rw;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+  rwlock_acquire_read (&rw);
+  thread_create ("writer", PRI_DEFAULT + 2, writer_thread_func, &rw);
+  thread_create ("reader", PRI_DEFAULT + 3, reader_thread_func, &rw);
+  msg ("Reader and writer are both waiting.");
+  rwlock_release_read (&rw);
+  msg ("Main thread finished.");
+}
+
+static void
+reader_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_read (rw);
+  msg ("Reader acquired read lock.");
+  rwlock_release_read (rw);
+  msg ("Reader done.");
+}
+
+static void
+writer_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_write (rw);
+  msg ("Writer acquired write lock.");
+  msg ("Writer should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 3, thread_get_priority ());
+  rwlock_release_write (rw);
+  msg ("Writer done.");
+}
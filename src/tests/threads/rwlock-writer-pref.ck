@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer-pref) begin
+(rwlock-writer-pref) Reader and writer are both waiting.
+(rwlock-writer-pref) Writer acquired write lock.
+(rwlock-writer-pref) Writer should have priority 34.  Actual priority: 34.
+(rwlock-writer-pref) Reader acquired read lock.
+(rwlock-writer-pref) Reader done.
+(rwlock-writer-pref) Writer done.
+(rwlock-writer-pref) Main thread finished.
+(rwlock-writer-pref) end
+EOF
+pass;
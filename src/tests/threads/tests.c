@@ -29,6 +29,11 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"priority-donate-rwlock", test_priority_donate_rwlock},
+    {"rwlock-basic", test_rwlock_basic},
+    {"rwlock-writer-pref", test_rwlock_writer_pref},
+    {"rwlock-bench", test_rwlock_bench},
+    {"workqueue-basic", test_workqueue_basic},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -23,6 +23,11 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_priority_donate_rwlock;
+extern test_func test_rwlock_basic;
+extern test_func test_rwlock_writer_pref;
+extern test_func test_rwlock_bench;
+extern test_func test_workqueue_basic;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
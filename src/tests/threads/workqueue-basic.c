@@ -0,0 +1,84 @@
+/* Queues work items of different priorities behind one that
+   blocks the only worker, cancels one of them, and checks that
+   the rest run highest priority first.  Then checks that delayed
+   work runs after its delay and that cancelled delayed work does
+   not run at all. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+static work_func gate_work, print_work;
+
+/* Workers never exit, so the workqueue must outlive the test. */
+static struct workqueue wq;
+static struct semaphore gate;
+
+void
+test_workqueue_basic (void) 
+{
+  struct work gate_item, a, b, c, d, e;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  /* The worker has a higher priority than we do, so it runs each
+     item as soon as it is queued, unless it is busy. */
+  workqueue_init (&wq, "worker", 1, PRI_DEFAULT + 1);
+  sema_init (&gate, 0);
+
+  work_init (&gate_item, gate_work, NULL, 0);
+  workqueue_queue (&wq, &gate_item);
+
+  work_init (&a, print_work, "A", 1);
+  work_init (&b, print_work, "B", 5);
+  work_init (&c, print_work, "C", 3);
+  work_init (&d, print_work, "D", 2);
+  workqueue_queue (&wq, &a);
+  workqueue_queue (&wq, &b);
+  workqueue_queue (&wq, &c);
+  workqueue_queue (&wq, &d);
+  if (workqueue_queue (&wq, &a))
+    fail ("queued pending work twice");
+  if (!workqueue_cancel (&d))
+    fail ("could not cancel pending work");
+  msg ("Cancelled work D, opening gate.");
+  sema_up (&gate);
+  workqueue_flush (&wq);
+  msg ("Flushed.");
+
+  work_init (&e, print_work, "E", 0);
+  workqueue_queue_delayed (&wq, &e, 5);
+  if (workqueue_queue (&wq, &e))
+    fail ("queued delayed work twice");
+  msg ("Queued work E with a delay.");
+  timer_sleep (10);
+  msg ("Slept past the delay.");
+
+  workqueue_queue_delayed (&wq, &e, 5);
+  if (!workqueue_cancel (&e))
+    fail ("could not cancel delayed work");
+  timer_sleep (10);
+  msg ("Cancelled delayed work did not run.");
+}
+
+static void
+gate_work (void *aux UNUSED) 
+{
+  msg ("Worker waiting at gate.");
+  sema_down (&gate);
+  msg ("Worker passed gate.");
+}
+
+static void
+print_work (void *name) 
+{
+  msg ("Work %s.", (const char *) name);
+}
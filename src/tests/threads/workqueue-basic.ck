@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue-basic) begin
+(workqueue-basic) Worker waiting at gate.
+(workqueue-basic) Cancelled work D, opening gate.
+(workqueue-basic) Worker passed gate.
+(workqueue-basic) Work B.
+(workqueue-basic) Work C.
+(workqueue-basic) Work A.
+(workqueue-basic) Flushed.
+(workqueue-basic) Queued work E with a delay.
+(workqueue-basic) Work E.
+(workqueue-basic) Slept past the delay.
+(workqueue-basic) Cancelled delayed work did not run.
+(workqueue-basic) end
+EOF
+pass;
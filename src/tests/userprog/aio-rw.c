@@ -0,0 +1,73 @@
+/* Writes a file in two halves and reads it back through the
+   asynchronous I/O rings, then verifies the file the usual way. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define RING ((struct aio_ring *) 0x10000000)
+
+static void
+queue (uint32_t opcode, int fd, void *buf, unsigned len, unsigned ofs,
+       uint32_t user_data)
+{
+  struct aio_sqe *sqe = &RING->sqes[RING->sq_tail % AIO_SQ_ENTRIES];
+
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->buf = buf;
+  sqe->len = len;
+  sqe->offset = ofs;
+  sqe->user_data = user_data;
+  RING->sq_tail++;
+}
+
+/* Reaps one completion and returns its result, checking that it
+   belongs to one of the submissions in WANT. */
+static int
+reap (uint32_t want)
+{
+  struct aio_cqe *cqe;
+
+  if (RING->cq_head == RING->cq_tail)
+    fail ("no completion ready");
+  cqe = &RING->cqes[RING->cq_head % AIO_CQ_ENTRIES];
+  if ((cqe->user_data & want) == 0)
+    fail ("unexpected completion %u", cqe->user_data);
+  RING->cq_head++;
+  return cqe->res;
+}
+
+void
+test_main (void) 
+{
+  char buf[sizeof sample];
+  size_t size = sizeof sample - 1;
+  size_t half = size / 2;
+  int handle, i;
+
+  CHECK (create ("aio.txt", 0), "create \"aio.txt\"");
+  CHECK ((handle = open ("aio.txt")) > 1, "open \"aio.txt\"");
+  CHECK (aio_setup (RING), "aio_setup");
+
+  queue (AIO_OP_WRITE, handle, sample, half, 0, 1);
+  queue (AIO_OP_WRITE, handle, sample + half, size - half, half, 2);
+  CHECK (aio_enter (2, 2) == 2, "submit two writes");
+  for (i = 0; i < 2; i++)
+    if (reap (1 | 2) <= 0)
+      fail ("write failed");
+
+  memset (buf, 0, sizeof buf);
+  queue (AIO_OP_READ, handle, buf, size, 0, 4);
+  CHECK (aio_enter (1, 1) == 1, "submit read");
+  if (reap (4) != (int) size)
+    fail ("read returned wrong size");
+  if (memcmp (buf, sample, size))
+    fail ("read returned wrong data");
+  if (tell (handle) != 0)
+    fail ("asynchronous I/O moved the file position");
+
+  check_file_handle (handle, "aio.txt", sample, size);
+}
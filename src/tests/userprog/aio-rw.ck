@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(aio-rw) begin
+(aio-rw) create "aio.txt"
+(aio-rw) open "aio.txt"
+(aio-rw) aio_setup
+(aio-rw) submit two writes
+(aio-rw) submit read
+(aio-rw) verified contents of "aio.txt"
+(aio-rw) end
+aio-rw: exit(0)
+EOF
+pass;
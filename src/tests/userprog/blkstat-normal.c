@@ -0,0 +1,47 @@
+/* Writes and syncs a file, then walks the block devices with
+   blkstat() and checks that the file system device counted the
+   writes in its statistics. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct blkstat stats;
+  const struct blkstat_dir *w;
+  bool found = false;
+  uint64_t total;
+  unsigned i;
+  int handle, b;
+
+  CHECK (create ("stats.txt", 0), "create \"stats.txt\"");
+  CHECK ((handle = open ("stats.txt")) > 1, "open \"stats.txt\"");
+  CHECK (write (handle, sample, sizeof sample - 1)
+         == (int) sizeof sample - 1, "write \"stats.txt\"");
+  CHECK (fsync (handle), "fsync \"stats.txt\"");
+  close (handle);
+
+  for (i = 0; blkstat (i, &stats); i++)
+    {
+      if (strcmp (stats.role, "filesys"))
+        continue;
+      found = true;
+
+      w = &stats.dir[BLKSTAT_WRITE];
+      if (w->ops == 0 || w->bytes < w->ops * 512)
+        fail ("%s: %llu writes of %llu bytes", stats.name, w->ops, w->bytes);
+
+      total = 0;
+      for (b = 0; b < BLKSTAT_BUCKETS; b++)
+        total += w->hist[b];
+      if (total != w->ops)
+        fail ("%s: histogram holds %llu of %llu writes",
+              stats.name, total, w->ops);
+    }
+  CHECK (found, "found file system device");
+  CHECK (!blkstat (i, &stats), "blkstat past last device");
+}
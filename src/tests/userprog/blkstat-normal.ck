@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(blkstat-normal) begin
+(blkstat-normal) create "stats.txt"
+(blkstat-normal) open "stats.txt"
+(blkstat-normal) write "stats.txt"
+(blkstat-normal) fsync "stats.txt"
+(blkstat-normal) found file system device
+(blkstat-normal) blkstat past last device
+(blkstat-normal) end
+blkstat-normal: exit(0)
+EOF
+pass;
@@ -0,0 +1,32 @@
+/* Copies a file into a new one with copy_file_range() and checks
+   the copy, along with the positions of both descriptors. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int in_fd, out_fd, byte_cnt;
+  unsigned size = sizeof sample - 1;
+
+  CHECK (create ("copy.txt", 0), "create \"copy.txt\"");
+  CHECK ((in_fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((out_fd = open ("copy.txt")) > 1, "open \"copy.txt\"");
+
+  byte_cnt = copy_file_range (in_fd, out_fd, size);
+  if (byte_cnt != (int) size)
+    fail ("copy_file_range() returned %d instead of %u", byte_cnt, size);
+  if (tell (in_fd) != size || tell (out_fd) != size)
+    fail ("copy_file_range() left positions at %u and %u",
+          tell (in_fd), tell (out_fd));
+
+  byte_cnt = copy_file_range (in_fd, out_fd, size);
+  if (byte_cnt != 0)
+    fail ("copy_file_range() at end of file returned %d", byte_cnt);
+
+  close (out_fd);
+  check_file ("copy.txt", sample, size);
+}
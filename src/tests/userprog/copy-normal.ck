@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-normal) begin
+(copy-normal) create "copy.txt"
+(copy-normal) open "sample.txt"
+(copy-normal) open "copy.txt"
+(copy-normal) open "copy.txt" for verification
+(copy-normal) verified contents of "copy.txt"
+(copy-normal) close "copy.txt"
+(copy-normal) end
+copy-normal: exit(0)
+EOF
+pass;
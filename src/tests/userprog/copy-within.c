@@ -0,0 +1,46 @@
+/* Copies within one file with copy_file_range().  Copying to the
+   same descriptor and copying between overlapping ranges of the
+   file must fail, while a copy to a range past the source extends
+   the file with a second copy of its contents. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char twice[2 * (sizeof sample - 1)];
+  unsigned size = sizeof sample - 1;
+  int in_fd, out_fd, byte_cnt;
+
+  CHECK (create ("within.txt", 0), "create \"within.txt\"");
+  CHECK ((in_fd = open ("within.txt")) > 1, "open \"within.txt\"");
+  CHECK (write (in_fd, sample, size) == (int) size, "write \"within.txt\"");
+  CHECK ((out_fd = open ("within.txt")) > 1, "open \"within.txt\" again");
+
+  seek (in_fd, 0);
+  CHECK (copy_file_range (in_fd, in_fd, size) == -1,
+         "copy to the same descriptor fails");
+
+  seek (out_fd, 10);
+  CHECK (copy_file_range (in_fd, out_fd, 20) == -1,
+         "copy between overlapping ranges fails");
+  if (tell (in_fd) != 0 || tell (out_fd) != 10)
+    fail ("failed copy moved the positions to %u and %u",
+          tell (in_fd), tell (out_fd));
+
+  seek (out_fd, size);
+  byte_cnt = copy_file_range (in_fd, out_fd, size);
+  if (byte_cnt != (int) size)
+    fail ("copy_file_range() returned %d instead of %u", byte_cnt, size);
+  msg ("close \"within.txt\"");
+  close (in_fd);
+  close (out_fd);
+
+  memcpy (twice, sample, size);
+  memcpy (twice + size, sample, size);
+  check_file ("within.txt", twice, sizeof twice);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-within) begin
+(copy-within) create "within.txt"
+(copy-within) open "within.txt"
+(copy-within) write "within.txt"
+(copy-within) open "within.txt" again
+(copy-within) copy to the same descriptor fails
+(copy-within) copy between overlapping ranges fails
+(copy-within) close "within.txt"
+(copy-within) open "within.txt" for verification
+(copy-within) verified contents of "within.txt"
+(copy-within) close "within.txt"
+(copy-within) end
+copy-within: exit(0)
+EOF
+pass;
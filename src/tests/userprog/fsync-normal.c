@@ -0,0 +1,26 @@
+/* Writes a file, forces it to disk with fsync() and fdatasync(),
+   and checks that syncing the console descriptors fails. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int handle;
+  size_t size = sizeof sample - 1;
+
+  CHECK (create ("sync.txt", 0), "create \"sync.txt\"");
+  CHECK ((handle = open ("sync.txt")) > 1, "open \"sync.txt\"");
+  CHECK (write (handle, sample, size) == (int) size, "write \"sync.txt\"");
+  CHECK (fdatasync (handle), "fdatasync \"sync.txt\"");
+  CHECK (fsync (handle), "fsync \"sync.txt\"");
+  CHECK (!fsync (STDOUT_FILENO), "fsync stdout");
+  msg ("close \"sync.txt\"");
+  close (handle);
+
+  check_file ("sync.txt", sample, size);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fsync-normal) begin
+(fsync-normal) create "sync.txt"
+(fsync-normal) open "sync.txt"
+(fsync-normal) write "sync.txt"
+(fsync-normal) fdatasync "sync.txt"
+(fsync-normal) fsync "sync.txt"
+(fsync-normal) fsync stdout
+(fsync-normal) close "sync.txt"
+(fsync-normal) open "sync.txt" for verification
+(fsync-normal) verified contents of "sync.txt"
+(fsync-normal) close "sync.txt"
+(fsync-normal) end
+fsync-normal: exit(0)
+EOF
+pass;
@@ -0,0 +1,52 @@
+/* Writes a file and closes it while its data is still cached,
+   then reopens it, rewrites the same data and calls fdatasync().
+   Checks with blkstat() that the sync wrote the data block to the
+   file system device, even though the block was already dirty
+   when the file was reopened. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Returns the number of bytes written to the file system device. */
+static uint64_t
+filesys_written (void)
+{
+  struct blkstat stats;
+  unsigned i;
+
+  for (i = 0; blkstat (i, &stats); i++)
+    if (!strcmp (stats.role, "filesys"))
+      return stats.dir[BLKSTAT_WRITE].bytes;
+  fail ("no file system device");
+  return 0;
+}
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  uint64_t before, after;
+  int handle;
+
+  CHECK (create ("sync.txt", 0), "create \"sync.txt\"");
+  CHECK ((handle = open ("sync.txt")) > 1, "open \"sync.txt\"");
+  CHECK (write (handle, sample, size) == (int) size, "write \"sync.txt\"");
+  msg ("close \"sync.txt\"");
+  close (handle);
+
+  CHECK ((handle = open ("sync.txt")) > 1, "reopen \"sync.txt\"");
+  CHECK (write (handle, sample, size) == (int) size, "rewrite \"sync.txt\"");
+  before = filesys_written ();
+  CHECK (fdatasync (handle), "fdatasync \"sync.txt\"");
+  after = filesys_written ();
+  if (after - before < 512)
+    fail ("fdatasync wrote %llu bytes, expected at least 512",
+          after - before);
+  msg ("close \"sync.txt\"");
+  close (handle);
+
+  check_file ("sync.txt", sample, size);
+}
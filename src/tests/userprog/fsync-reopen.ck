@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fsync-reopen) begin
+(fsync-reopen) create "sync.txt"
+(fsync-reopen) open "sync.txt"
+(fsync-reopen) write "sync.txt"
+(fsync-reopen) close "sync.txt"
+(fsync-reopen) reopen "sync.txt"
+(fsync-reopen) rewrite "sync.txt"
+(fsync-reopen) fdatasync "sync.txt"
+(fsync-reopen) close "sync.txt"
+(fsync-reopen) open "sync.txt" for verification
+(fsync-reopen) verified contents of "sync.txt"
+(fsync-reopen) close "sync.txt"
+(fsync-reopen) end
+fsync-reopen: exit(0)
+EOF
+pass;
@@ -0,0 +1,30 @@
+/* Checks the futex calls and the user mutex without contention:
+   futex_wait() on a word that no longer holds the expected value
+   returns at once, futex_wake() with no sleepers wakes nobody, and
+   locking and unlocking a free mutex never needs a sleeper. */
+
+#include <synch.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int word = 5;
+static struct mutex m = MUTEX_INITIALIZER;
+static struct condvar cv = CONDVAR_INITIALIZER;
+
+void
+test_main (void) 
+{
+  CHECK (futex_wait (&word, 4) == -1, "futex_wait on changed word");
+  CHECK (futex_wake (&word, 1) == 0, "futex_wake without sleepers");
+
+  mutex_lock (&m);
+  CHECK (m.state == 1, "uncontended lock");
+  CHECK (!mutex_trylock (&m), "trylock of held mutex fails");
+  condvar_signal (&cv);
+  condvar_broadcast (&cv);
+  mutex_unlock (&m);
+  CHECK (m.state == 0, "unlock");
+  CHECK (mutex_trylock (&m), "trylock of free mutex succeeds");
+  mutex_unlock (&m);
+}
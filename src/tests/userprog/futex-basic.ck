@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-basic) begin
+(futex-basic) futex_wait on changed word
+(futex-basic) futex_wake without sleepers
+(futex-basic) uncontended lock
+(futex-basic) trylock of held mutex fails
+(futex-basic) unlock
+(futex-basic) trylock of free mutex succeeds
+(futex-basic) end
+futex-basic: exit(0)
+EOF
+pass;
@@ -0,0 +1,43 @@
+/* Does some file system work, then walks the lock names with
+   lockstat() and checks that the file system lock counted its
+   acquisitions consistently. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct lockstat stats;
+  bool found = false;
+  unsigned i;
+  int handle;
+
+  CHECK (create ("locks.txt", 0), "create \"locks.txt\"");
+  CHECK ((handle = open ("locks.txt")) > 1, "open \"locks.txt\"");
+  CHECK (write (handle, sample, sizeof sample - 1)
+         == (int) sizeof sample - 1, "write \"locks.txt\"");
+  close (handle);
+
+  for (i = 0; lockstat (i, &stats); i++)
+    {
+      if (strcmp (stats.name, "filesys"))
+        continue;
+      found = true;
+
+      if (stats.locks == 0 || stats.acquisitions < 3)
+        fail ("%s: %u locks, %llu acquisitions",
+              stats.name, stats.locks, stats.acquisitions);
+      if (stats.contended > stats.acquisitions)
+        fail ("%s: %llu of %llu acquisitions contended",
+              stats.name, stats.contended, stats.acquisitions);
+      if (stats.wait_max_us > stats.wait_total_us
+          || stats.hold_max_us > stats.hold_total_us)
+        fail ("%s: maximum exceeds total", stats.name);
+    }
+  CHECK (found, "found file system lock");
+  CHECK (!lockstat (i, &stats), "lockstat past last lock");
+}
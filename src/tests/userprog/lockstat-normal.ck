@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(lockstat-normal) begin
+(lockstat-normal) create "locks.txt"
+(lockstat-normal) open "locks.txt"
+(lockstat-normal) write "locks.txt"
+(lockstat-normal) found file system lock
+(lockstat-normal) lockstat past last lock
+(lockstat-normal) end
+lockstat-normal: exit(0)
+EOF
+pass;
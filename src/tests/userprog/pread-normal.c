@@ -0,0 +1,34 @@
+/* Reads pieces of a file with pread() and verifies that the file
+   position is left untouched, so that a following read() still
+   starts at the beginning of the file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[sizeof sample];
+  int handle, byte_cnt;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  byte_cnt = pread (handle, buf, 32, 40);
+  if (byte_cnt != 32)
+    fail ("pread() returned %d instead of 32", byte_cnt);
+  if (memcmp (buf, sample + 40, 32))
+    fail ("pread() at offset 40 returned wrong data");
+  if (tell (handle) != 0)
+    fail ("pread() moved the file position to %u", tell (handle));
+
+  byte_cnt = pread (handle, buf, sizeof buf, sizeof sample - 11);
+  if (byte_cnt != 10)
+    fail ("pread() near end of file returned %d instead of 10", byte_cnt);
+  if (memcmp (buf, sample + sizeof sample - 11, 10))
+    fail ("pread() near end of file returned wrong data");
+
+  check_file_handle (handle, "sample.txt", sample, sizeof sample - 1);
+}
@@ -0,0 +1,37 @@
+/* Reads a file into three buffers of uneven size with a single
+   readv() call and checks that the buffers were filled in order. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char a[7], b[50], c[sizeof sample];
+  struct iovec iov[3];
+  int handle, byte_cnt;
+  size_t size = sizeof sample - 1;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  iov[0].iov_base = a;
+  iov[0].iov_len = sizeof a;
+  iov[1].iov_base = b;
+  iov[1].iov_len = sizeof b;
+  iov[2].iov_base = c;
+  iov[2].iov_len = sizeof c;
+
+  byte_cnt = readv (handle, iov, 3);
+  if (byte_cnt != (int) size)
+    fail ("readv() returned %d instead of %zu", byte_cnt, size);
+  if (memcmp (a, sample, sizeof a)
+      || memcmp (b, sample + sizeof a, sizeof b)
+      || memcmp (c, sample + sizeof a + sizeof b,
+                 size - sizeof a - sizeof b))
+    fail ("readv() scattered the data incorrectly");
+  if (tell (handle) != size)
+    fail ("readv() left the file position at %u", tell (handle));
+}
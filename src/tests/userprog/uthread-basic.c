@@ -0,0 +1,53 @@
+/* Starts several threads that share a counter under a user mutex, each
+   growing its own stack by a few pages, and checks that thread_join()
+   returns what each thread returned and that all of them updated the
+   same counter.  Joining a thread twice fails. */
+
+#include <string.h>
+#include <synch.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ITERATIONS 500
+
+static struct mutex m = MUTEX_INITIALIZER;
+static int counter;
+
+static int
+worker (void *aux)
+{
+  int id = (int) aux;
+  char big[16384];
+  size_t i;
+
+  memset (big, id, sizeof big);
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      mutex_lock (&m);
+      counter++;
+      mutex_unlock (&m);
+    }
+  for (i = 0; i < sizeof big; i++)
+    if (big[i] != id)
+      return -1;
+  return 100 + id;
+}
+
+void
+test_main (void) 
+{
+  tid_t tids[THREAD_CNT];
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      tids[i] = thread_create (worker, (void *) i);
+      CHECK (tids[i] != TID_ERROR, "create thread %d", i);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (thread_join (tids[i]) == 100 + i, "join thread %d", i);
+  CHECK (counter == THREAD_CNT * ITERATIONS, "counter is %d", counter);
+  CHECK (thread_join (tids[0]) == -1, "second join fails");
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uthread-basic) begin
+(uthread-basic) create thread 0
+(uthread-basic) create thread 1
+(uthread-basic) create thread 2
+(uthread-basic) create thread 3
+(uthread-basic) join thread 0
+(uthread-basic) join thread 1
+(uthread-basic) join thread 2
+(uthread-basic) join thread 3
+(uthread-basic) counter is 2000
+(uthread-basic) second join fails
+(uthread-basic) end
+uthread-basic: exit(0)
+EOF
+pass;
@@ -0,0 +1,40 @@
+/* Calls exit() while one thread of the process spins in user code
+   and another waits in thread_join() for a thread that also spins.
+   The process must still end, with the status given to exit(). */
+
+#include <stdbool.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Never set, so the spinners only stop when the process ends. */
+static volatile bool stop;
+
+static int
+spinner (void *aux UNUSED)
+{
+  while (!stop)
+    continue;
+  return 0;
+}
+
+static int
+joiner (void *aux UNUSED)
+{
+  tid_t tid = thread_create (spinner, NULL);
+
+  if (tid != TID_ERROR)
+    thread_join (tid);
+  return 0;
+}
+
+void
+test_main (void) 
+{
+  CHECK (thread_create (spinner, NULL) != TID_ERROR,
+         "create spinning thread");
+  CHECK (thread_create (joiner, NULL) != TID_ERROR,
+         "create joining thread");
+  msg ("exit");
+  exit (57);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uthread-exit) begin
+(uthread-exit) create spinning thread
+(uthread-exit) create joining thread
+(uthread-exit) exit
+uthread-exit: exit(57)
+EOF
+pass;
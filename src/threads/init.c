@@ -18,10 +18,13 @@
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
+#include "threads/lockstat.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/schedtrace.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #include "vm/swap.h"
 
 #ifdef USERPROG
@@ -40,8 +43,11 @@
 
 #ifdef FILESYS
 
+#include "devices/blktrace.h"
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "devices/ramdisk.h"
+#include "devices/virtio-blk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 
@@ -61,8 +67,17 @@ static const char *scratch_bdev_name;
 #ifdef VM
 static const char *swap_bdev_name;
 #endif
+
+/* -rd: Size of the RAM disk in kB, or 0 for none. */
+static size_t ramdisk_kb;
+
+/* -blktrace: Trace block I/O to the scratch device? */
+static bool trace_blocks;
 #endif /* FILESYS */
 
+/*! -schedtrace: Trace context switches to the scratch device? */
+static bool trace_sched;
+
 /*! -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
@@ -112,6 +127,9 @@ int main(void) {
     gdt_init();
 #endif
 
+    if (trace_sched)
+        schedtrace_start();
+
     /* Initialize interrupt handlers. */
     intr_init();
     timer_init();
@@ -126,10 +144,16 @@ int main(void) {
     thread_start();
     serial_init_queue();
     timer_calibrate();
+    workqueue_init(&system_wq, "kworker", SYSTEM_WQ_WORKERS, PRI_DEFAULT);
 
 #ifdef FILESYS
     /* Initialize file system. */
+    if (trace_blocks)
+        blktrace_start();
     ide_init();
+    virtio_blk_init();
+    if (ramdisk_kb > 0)
+        ramdisk_init(ramdisk_kb);
     locate_block_devices();
     filesys_init(format_filesys);
     swap_init();
@@ -243,6 +267,14 @@ static char ** parse_options(char **argv) {
             filesys_bdev_name = value;
         else if (!strcmp(name, "-scratch"))
             scratch_bdev_name = value;
+        else if (!strcmp(name, "-rd")) {
+            int kb = value != NULL ? atoi(value) : 0;
+            if (kb <= 0)
+                PANIC("-rd needs a positive size in kB (use -h for help)");
+            ramdisk_kb = kb;
+        }
+        else if (!strcmp(name, "-blktrace"))
+            trace_blocks = true;
 #ifdef VM
         else if (!strcmp(name, "-swap"))
             swap_bdev_name = value;
@@ -252,6 +284,12 @@ static char ** parse_options(char **argv) {
             random_init(atoi(value));
         else if (!strcmp(name, "-mlfqs"))
             thread_mlfqs = true;
+        else if (!strcmp(name, "-tickless"))
+            timer_tickless = true;
+        else if (!strcmp(name, "-lockstat"))
+            lockstat_enabled = true;
+        else if (!strcmp(name, "-schedtrace"))
+            trace_sched = true;
 #ifdef USERPROG
         else if (!strcmp(name, "-ul"))
             user_page_limit = atoi(value);
@@ -259,6 +297,10 @@ static char ** parse_options(char **argv) {
         else
             PANIC("unknown option `%s' (use -h for help)", name);
     }
+#ifdef FILESYS
+    if (trace_blocks && trace_sched)
+        PANIC("-blktrace and -schedtrace both write to the scratch device");
+#endif
 
     /* Initialize the random number generator based on the system
        time.  This has no effect if an "-rs" option was specified.
@@ -363,12 +405,17 @@ static void usage(void) {
            "  -f                 Format file system device during startup.\n"
            "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
            "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+           "  -rd=KB             Create a KB kB RAM disk named ram0.\n"
+           "  -blktrace          Trace block I/O, saved to scratch at exit.\n"
 #ifdef VM
            "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
 #endif
            "  -rs=SEED           Set random number seed to SEED.\n"
            "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+           "  -tickless          Interrupt only when a timer or time slice ends.\n"
+           "  -lockstat          Record lock contention, printed at exit.\n"
+           "  -schedtrace        Trace scheduling, saved to scratch at exit.\n"
 #ifdef USERPROG
            "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -9,6 +9,10 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#include "userprog/process.h"
+#endif
 
 /*! Programmable Interrupt Controller (PIC) registers.
     A PC has two PICs, called the master and slave PICs, with the
@@ -347,8 +351,15 @@ void intr_handler(struct intr_frame *frame) {
         pic_end_of_interrupt(frame->vec_no); 
 
         if (yield_on_return) 
-            thread_yield(); 
+            thread_preempt(); 
     }
+
+#ifdef USERPROG
+    /* Instead of returning to user mode, leave if another thread of the
+       process has ended it. */
+    if (frame->cs == SEL_UCSEG)
+        process_check_exiting();
+#endif
 }
 
 /*! Handles an unexpected interrupt with interrupt frame F.  An
@@ -0,0 +1,94 @@
+#include "threads/lockstat.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+
+/*! Most distinct lock names that are tracked.  Locks initialized with a
+    name beyond these go untracked. */
+#define LOCKSTAT_MAX 32
+
+/*! If true, record lock contention statistics.  Controlled by kernel
+    command-line option "-lockstat". */
+bool lockstat_enabled;
+
+/*! Entries in order of registration.  Statically allocated, since the
+    first locks are initialized before malloc() works. */
+static struct lockstat_entry entries[LOCKSTAT_MAX];
+static unsigned entry_cnt;
+
+/*! Returns the entry for locks named NAME, creating it if needed, or NULL
+    if the table is full.  NAME must remain valid forever, as a string
+    literal does. */
+struct lockstat_entry *lockstat_register(const char *name) {
+    struct lockstat_entry *e = NULL;
+    enum intr_level old_level;
+    unsigned i;
+
+    ASSERT(name != NULL);
+
+    old_level = intr_disable();
+    for (i = 0; i < entry_cnt; i++)
+        if (!strcmp(entries[i].name, name)) {
+            e = &entries[i];
+            break;
+        }
+    if (e == NULL && entry_cnt < LOCKSTAT_MAX) {
+        e = &entries[entry_cnt++];
+        e->name = name;
+    }
+    if (e != NULL)
+        e->locks++;
+    intr_set_level(old_level);
+    return e;
+}
+
+/*! Prints statistics for every lock name that saw any acquisitions. */
+void lockstat_print(void) {
+    unsigned i;
+
+    if (!lockstat_enabled)
+        return;
+
+    printf("Locks:\n");
+    for (i = 0; i < entry_cnt; i++) {
+        const struct lockstat_entry *e = &entries[i];
+        if (e->acquisitions == 0)
+            continue;
+        printf("  %s (%u): %"PRIu64" acquisitions, %"PRIu64" contended, "
+               "wait avg %"PRIu64" max %"PRIu64" us, "
+               "hold avg %"PRIu64" max %"PRIu64" us\n",
+               e->name, e->locks, e->acquisitions, e->contended,
+               e->contended != 0
+               ? timer_cycles_to_us(e->wait_cycles / e->contended) : 0,
+               timer_cycles_to_us(e->wait_max),
+               timer_cycles_to_us(e->hold_cycles / e->acquisitions),
+               timer_cycles_to_us(e->hold_max));
+    }
+}
+
+/*! Copies the statistics of the lock name registered at position INDEX
+    into *STATS.  Returns false if there is no such name. */
+bool lockstat_get(unsigned index, struct lockstat *stats) {
+    struct lockstat_entry e;
+    enum intr_level old_level;
+
+    if (index >= entry_cnt)
+        return false;
+    old_level = intr_disable();
+    e = entries[index];
+    intr_set_level(old_level);
+
+    memset(stats, 0, sizeof *stats);
+    strlcpy(stats->name, e.name, sizeof stats->name);
+    stats->locks = e.locks;
+    stats->acquisitions = e.acquisitions;
+    stats->contended = e.contended;
+    stats->wait_total_us = timer_cycles_to_us(e.wait_cycles);
+    stats->wait_max_us = timer_cycles_to_us(e.wait_max);
+    stats->hold_total_us = timer_cycles_to_us(e.hold_cycles);
+    stats->hold_max_us = timer_cycles_to_us(e.hold_max);
+    return true;
+}
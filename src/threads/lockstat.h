@@ -0,0 +1,28 @@
+#ifndef THREADS_LOCKSTAT_H
+#define THREADS_LOCKSTAT_H
+
+#include <lockstat.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*! If true, record lock contention statistics.  Controlled by kernel
+    command-line option "-lockstat". */
+extern bool lockstat_enabled;
+
+/*! Statistics for the locks sharing one name, in TSC cycles. */
+struct lockstat_entry {
+    const char *name;           /*!< Name of the locks. */
+    unsigned locks;             /*!< Locks initialized with the name. */
+    uint64_t acquisitions;      /*!< Successful acquisitions. */
+    uint64_t contended;         /*!< Acquisitions that had to wait. */
+    uint64_t wait_cycles;       /*!< Total wait. */
+    uint64_t wait_max;          /*!< Longest wait. */
+    uint64_t hold_cycles;       /*!< Total hold time. */
+    uint64_t hold_max;          /*!< Longest hold. */
+};
+
+struct lockstat_entry *lockstat_register(const char *name);
+void lockstat_print(void);
+bool lockstat_get(unsigned index, struct lockstat *);
+
+#endif /* threads/lockstat.h */
@@ -77,7 +77,7 @@ void malloc_init(void) {
         d->block_size = block_size;
         d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
         list_init(&d->free_list);
-        lock_init(&d->lock);
+        lock_init_named(&d->lock, "malloc");
     }
 }
 
@@ -153,7 +153,7 @@ static void init_pool(struct pool *p, void *base, size_t page_cnt,
     printf("%zu pages available in %s.\n", page_cnt, name);
 
     /* Initialize the pool. */
-    lock_init(&p->lock);
+    lock_init_named(&p->lock, name);
     p->used_map = bitmap_create_in_buf(page_cnt, base, bm_pages * PGSIZE);
     p->base = base + bm_pages * PGSIZE;
 }
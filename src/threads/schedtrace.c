@@ -0,0 +1,181 @@
+/*! \file schedtrace.c
+
+   Scheduler tracer.  Once started, it records each context switch, with
+   the reason the previous thread gave up the CPU, and each wakeup of a
+   blocked thread in a ring buffer.  When the ring is full the oldest
+   entries are overwritten.  Pintos runs on a single CPU, so there is a
+   single ring and every entry is for CPU 0.
+
+   At shutdown a short summary is printed and the ring is written to the
+   scratch device in the format described in lib/schedtrace.h, overwriting
+   whatever the scratch device held, so do not combine -schedtrace with
+   -blktrace or with the pintos script's -g. */
+
+#include "threads/schedtrace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/*! Pages of memory given to the ring. */
+#define RING_PAGES 32
+
+/*! Number of entries in the ring. */
+#define RING_CNT (RING_PAGES * PGSIZE / sizeof (struct schedtrace_entry))
+
+static struct schedtrace_entry *ring;   /*!< NULL while not tracing. */
+static uint32_t recorded;               /*!< Entries ever recorded. */
+static tid_t idle_tid = TID_ERROR;      /*!< Tid of the idle thread. */
+
+/* Totals kept while tracing, for the summary printed at shutdown. */
+static uint64_t switches[SCHEDTRACE_EXIT + 1];  /*!< By reason. */
+static uint64_t wakeups;
+
+/*! Starts tracing.  Panics if memory for the ring is not available. */
+void schedtrace_start(void) {
+    ring = palloc_get_multiple(PAL_ASSERT, RING_PAGES);
+    recorded = 0;
+}
+
+/*! Appends E to the ring.  Interrupts must be off. */
+static void record(struct schedtrace_entry *e) {
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    e->tsc = timer_cycles();
+    e->cpu = 0;
+    ring[recorded++ % RING_CNT] = *e;
+}
+
+/*! Notes that IDLE is the idle thread, which the host tool leaves out of
+    its latency and runtime reports. */
+void schedtrace_set_idle(const struct thread *idle) {
+    idle_tid = idle->tid;
+}
+
+/*! Records that T was unblocked, leaving READY_CNT threads ready to run.
+    Interrupts must be off. */
+void schedtrace_wakeup(const struct thread *t, size_t ready_cnt) {
+    struct schedtrace_entry e;
+
+    if (ring == NULL)
+        return;
+
+    e.type = SCHEDTRACE_WAKEUP;
+    e.reason = 0;
+    e.tid = t->tid;
+    e.next_tid = TID_ERROR;
+    e.priority = thread_effective_priority(t);
+    e.next_priority = 0;
+    e.ready_cnt = ready_cnt;
+    record(&e);
+    wakeups++;
+}
+
+/*! Records a switch from PREV, which gave up the CPU for REASON, one of
+    the SCHEDTRACE_* reasons, to NEXT, which was picked from a run queue
+    that then held READY_CNT threads.  Interrupts must be off. */
+void schedtrace_switch(const struct thread *prev, const struct thread *next,
+                       int reason, size_t ready_cnt) {
+    struct schedtrace_entry e;
+
+    ASSERT(reason >= 0 && reason <= SCHEDTRACE_EXIT);
+
+    if (ring == NULL)
+        return;
+
+    e.type = SCHEDTRACE_SWITCH;
+    e.reason = reason;
+    e.tid = prev->tid;
+    e.next_tid = next->tid;
+    e.priority = thread_effective_priority(prev);
+    e.next_priority = thread_effective_priority(next);
+    e.ready_cnt = ready_cnt;
+    record(&e);
+    switches[reason]++;
+}
+
+/*! Stops tracing, prints a summary and writes the trace to the scratch
+    device, keeping the newest entries if it cannot hold them all.  Does
+    nothing if tracing is off. */
+void schedtrace_dump(void) {
+    struct block *scratch = block_get_role(BLOCK_SCRATCH);
+    struct schedtrace_entry *entries = ring;
+    struct schedtrace_header *h;
+    uint32_t cnt, max_cnt, i;
+    block_sector_t sec_no;
+    enum intr_level old_level;
+    uint8_t *buf;
+    size_t ofs;
+
+    ASSERT(sizeof *h <= BLOCK_SECTOR_SIZE);
+
+    if (entries == NULL)
+        return;
+
+    /* Stop first, so that the dump does not trace itself. */
+    old_level = intr_disable();
+    ring = NULL;
+    intr_set_level(old_level);
+
+    printf("schedtrace: %"PRIu64" wakeups, %"PRIu64" switches: "
+           "%"PRIu64" yield, %"PRIu64" block, %"PRIu64" preempt, "
+           "%"PRIu64" exit\n", wakeups,
+           switches[SCHEDTRACE_YIELD] + switches[SCHEDTRACE_BLOCK]
+           + switches[SCHEDTRACE_PREEMPT] + switches[SCHEDTRACE_EXIT],
+           switches[SCHEDTRACE_YIELD], switches[SCHEDTRACE_BLOCK],
+           switches[SCHEDTRACE_PREEMPT], switches[SCHEDTRACE_EXIT]);
+
+    if (scratch == NULL || block_size(scratch) < 2)
+        goto done;
+    buf = palloc_get_page(PAL_ZERO);
+    if (buf == NULL) {
+        printf("schedtrace: out of memory\n");
+        goto done;
+    }
+
+    cnt = recorded < RING_CNT ? recorded : RING_CNT;
+    max_cnt = (block_size(scratch) - 1) * SCHEDTRACE_PER_SECTOR;
+    if (cnt > max_cnt)
+        cnt = max_cnt;
+
+    h = (struct schedtrace_header *) buf;
+    memcpy(h->magic, SCHEDTRACE_MAGIC, sizeof h->magic);
+    h->version = SCHEDTRACE_VERSION;
+    h->entry_cnt = cnt;
+    h->lost = recorded - cnt;
+    h->cpu_cnt = 1;
+    h->cycles_per_sec = timer_cycles_per_sec();
+    h->idle_tid = idle_tid;
+    block_write(scratch, 0, buf);
+
+    /* Write the entries to the following sectors, oldest first, as many
+       whole entries to a sector as fit. */
+    sec_no = 1;
+    ofs = 0;
+    for (i = recorded - cnt; i != recorded; i++) {
+        memcpy(buf + ofs * sizeof *entries, &entries[i % RING_CNT],
+               sizeof *entries);
+        if (++ofs == SCHEDTRACE_PER_SECTOR) {
+            block_write(scratch, sec_no++, buf);
+            ofs = 0;
+        }
+    }
+    if (ofs > 0) {
+        memset(buf + ofs * sizeof *entries, 0,
+               BLOCK_SECTOR_SIZE - ofs * sizeof *entries);
+        block_write(scratch, sec_no, buf);
+    }
+
+    printf("schedtrace: wrote %"PRIu32" entries to %s, %"PRIu32" lost\n",
+           cnt, block_name(scratch), recorded - cnt);
+    palloc_free_page(buf);
+
+done:
+    palloc_free_multiple(entries, RING_PAGES);
+}
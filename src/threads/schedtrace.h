@@ -0,0 +1,16 @@
+#ifndef THREADS_SCHEDTRACE_H
+#define THREADS_SCHEDTRACE_H
+
+#include <schedtrace.h>
+#include <stddef.h>
+
+struct thread;
+
+void schedtrace_start(void);
+void schedtrace_set_idle(const struct thread *);
+void schedtrace_wakeup(const struct thread *, size_t ready_cnt);
+void schedtrace_switch(const struct thread *prev, const struct thread *next,
+                       int reason, size_t ready_cnt);
+void schedtrace_dump(void);
+
+#endif /* threads/schedtrace.h */
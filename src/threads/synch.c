@@ -34,9 +34,14 @@
 #include "threads/synch.h"
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/interrupt.h"
+#include "threads/lockstat.h"
 #include "threads/thread.h"
 
+static bool waiter_before(const struct list_elem *a,
+                          const struct list_elem *b, void *aux);
+
 /*! Initializes semaphore SEMA to VALUE.  A semaphore is a
     nonnegative integer along with two atomic operators for
     manipulating it:
@@ -68,13 +73,40 @@ void sema_down(struct semaphore *sema) {
 
     old_level = intr_disable();
     while (sema->value == 0) {
-        list_push_back(&sema->waiters, &thread_current()->elem);
+        thread_current()->waiting_sema = sema;
+        list_insert_ordered(&sema->waiters, &thread_current()->elem,
+                            waiter_before, NULL);
         thread_block();
     }
     sema->value--;
     intr_set_level(old_level);
 }
 
+/*! Like sema_down(), but gives up without decrementing SEMA if the
+    current thread is interrupted by thread_interrupt() while SEMA's
+    value is 0.  Returns true if SEMA was decremented, false otherwise. */
+bool sema_down_interruptible(struct semaphore *sema) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+    bool success;
+
+    ASSERT(sema != NULL);
+    ASSERT(!intr_context());
+
+    old_level = intr_disable();
+    while (sema->value == 0 && !cur->interrupted) {
+        cur->waiting_sema = sema;
+        list_insert_ordered(&sema->waiters, &cur->elem, waiter_before, NULL);
+        thread_block_interruptible();
+    }
+    success = sema->value > 0;
+    if (success)
+        sema->value--;
+    intr_set_level(old_level);
+
+    return success;
+}
+
 /*! Down or "P" operation on a semaphore, but only if the
     semaphore is not already 0.  Returns true if the semaphore is
     decremented, false otherwise.
@@ -112,12 +144,10 @@ void sema_up(struct semaphore *sema) {
     old_level = intr_disable();
     sema->value++;
     if (!list_empty(&sema->waiters)) {
-        t = list_entry(list_max(&sema->waiters, thread_prioritycomp, NULL),
-                       struct thread, elem);
-        list_remove(&t->elem);
+        t = list_entry(list_pop_front(&sema->waiters), struct thread, elem);
+        t->waiting_sema = NULL;
         thread_unblock(t);
-        if (t->priority > thread_get_priority() ||
-            t->donated_priority > thread_get_priority()) {
+        if (thread_effective_priority(t) > thread_get_priority()) {
             if (!intr_context())
                 thread_yield();
             else
@@ -127,6 +157,25 @@ void sema_up(struct semaphore *sema) {
     intr_set_level(old_level);
 }
 
+/*! Moves thread T, which is waiting on SEMA, to its place in SEMA's
+    waiters for its current effective priority.  Interrupts must be off. */
+void sema_requeue(struct semaphore *sema, struct thread *t) {
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(t->waiting_sema == sema);
+
+    list_remove(&t->elem);
+    list_insert_ordered(&sema->waiters, &t->elem, waiter_before, NULL);
+}
+
+/*! list_less_func that puts threads with a higher effective priority
+    first.  list_insert_ordered() puts a thread after those of equal
+    priority, so each priority is served in FIFO order. */
+static bool waiter_before(const struct list_elem *a,
+                          const struct list_elem *b, void *aux UNUSED) {
+    return (thread_effective_priority(list_entry(a, struct thread, elem)) >
+            thread_effective_priority(list_entry(b, struct thread, elem)));
+}
+
 static void sema_test_helper(void *sema_);
 
 /*! Self-test for semaphores that makes control "ping-pong"
@@ -174,11 +223,50 @@ static void sema_test_helper(void *sema_) {
    onerous, it's a good sign that a semaphore should be used,
    instead of a lock. */
 void lock_init(struct lock *lock) {
+    lock_init_named(lock, NULL);
+}
+
+/*! Initializes LOCK like lock_init() and, if NAME is non-null and the
+    kernel was started with -lockstat, records its contention statistics
+    under NAME.  Locks given the same name share one set of statistics.
+    NAME must remain valid forever, as a string literal does. */
+void lock_init_named(struct lock *lock, const char *name) {
     ASSERT(lock != NULL);
 
     lock->holder = NULL;
     sema_init(&lock->semaphore, 1);
     lock->priority = PRI_MIN;
+    lock->stats = NULL;
+    lock->acquired_at = 0;
+    if (name != NULL && lockstat_enabled)
+        lock->stats = lockstat_register(name);
+}
+
+/*! Records that LOCK was just acquired by the current thread, after
+    waiting since START if CONTENDED.  Interrupts must be off. */
+static void lock_account_acquire(struct lock *lock, bool contended,
+                                 uint64_t start) {
+    struct lockstat_entry *e = lock->stats;
+
+    lock->acquired_at = timer_cycles();
+    e->acquisitions++;
+    if (contended) {
+        uint64_t wait = lock->acquired_at - start;
+        e->contended++;
+        e->wait_cycles += wait;
+        if (wait > e->wait_max)
+            e->wait_max = wait;
+    }
+}
+
+/*! Records that LOCK is about to be released.  Interrupts must be off. */
+static void lock_account_release(struct lock *lock) {
+    struct lockstat_entry *e = lock->stats;
+    uint64_t hold = timer_cycles() - lock->acquired_at;
+
+    e->hold_cycles += hold;
+    if (hold > e->hold_max)
+        e->hold_max = hold;
 }
 
 /*! Acquires LOCK, sleeping until it becomes available if
@@ -192,6 +280,8 @@ void lock_init(struct lock *lock) {
 void lock_acquire(struct lock *lock) {
     enum intr_level old_level;
     struct thread *old_holder;
+    bool contended;
+    uint64_t start = 0;
 
     ASSERT(lock != NULL);
     ASSERT(!intr_context());
@@ -201,6 +291,9 @@ void lock_acquire(struct lock *lock) {
         return;
 
     old_level = intr_disable();
+    contended = lock->holder != NULL;
+    if (lock->stats != NULL && contended)
+        start = timer_cycles();
     if (!thread_mlfqs) {
         old_holder = lock->holder;
         if (old_holder)
@@ -209,6 +302,7 @@ void lock_acquire(struct lock *lock) {
             lock->priority = thread_get_priority();
             if (old_holder->donated_priority < lock->priority) {
                 old_holder->donated_priority = lock->priority;
+                thread_requeue(old_holder);
                 thread_update_locks(old_holder, 0);
             }
         }
@@ -216,6 +310,8 @@ void lock_acquire(struct lock *lock) {
     sema_down(&lock->semaphore);
     thread_current()->waiting_lock = NULL;
     lock->holder = thread_current();
+    if (lock->stats != NULL)
+        lock_account_acquire(lock, contended, start);
     if (!thread_mlfqs) {
         list_push_back(&thread_current()->locks, &lock->elem);
         lock_reset_priority(lock, 0);
@@ -235,13 +331,13 @@ void lock_reset_priority(struct lock *lock, int nest_level) {
         lock->priority = PRI_MIN;
     }
     else {
-        t = list_entry(list_max(&(&lock->semaphore)->waiters, 
-                                 thread_prioritycomp, NULL), 
+        /* The waiters are kept in priority order. */
+        t = list_entry(list_front(&(&lock->semaphore)->waiters),
                        struct thread, elem);
-        lock->priority = (t->donated_priority > t->priority ?
-                          t->donated_priority : t->priority);
+        lock->priority = thread_effective_priority(t);
         if (lock->priority > lock->holder->donated_priority) {
             lock->holder->donated_priority = lock->priority;
+            thread_requeue(lock->holder);
             if (nest_level < 8)
                 thread_update_locks(lock->holder, nest_level + 1);
         }
@@ -273,8 +369,13 @@ bool lock_try_acquire(struct lock *lock) {
     ASSERT(!lock_held_by_current_thread(lock));
 
     success = sema_try_down(&lock->semaphore);
-    if (success)
+    if (success) {
+      enum intr_level old_level = intr_disable();
       lock->holder = thread_current();
+      if (lock->stats != NULL)
+          lock_account_acquire(lock, false, 0);
+      intr_set_level(old_level);
+    }
 
     return success;
 }
@@ -291,6 +392,8 @@ void lock_release(struct lock *lock) {
     ASSERT(lock_held_by_current_thread(lock));
 
     old_level = intr_disable();
+    if (lock->stats != NULL)
+        lock_account_release(lock);
     lock->holder = NULL;
     if (!thread_mlfqs) {
         if (list_empty(&(&lock->semaphore)->waiters))
@@ -311,12 +414,256 @@ bool lock_held_by_current_thread(const struct lock *lock) {
     return lock->holder == thread_current();
 }
 
+/*! Initializes reader-writer lock RW.  Any number of threads may hold RW
+    shared, for reading, at the same time, while a thread holding it
+    exclusively, for writing, shuts out everyone else.
+
+    Writers are preferred: once a writer waits, new readers wait behind it,
+    so that a steady stream of readers cannot starve writers.  A release
+    hands RW straight to the next holders, so a woken thread never has to
+    compete for it again.  As with locks, waiting threads donate their
+    priority, to the writer or to every reader holding RW. */
+void rwlock_init(struct rwlock *rw) {
+    ASSERT(rw != NULL);
+
+    rw->writer = NULL;
+    list_init(&rw->readers);
+    sema_init(&rw->read_queue, 0);
+    sema_init(&rw->write_queue, 0);
+    rw->priority = PRI_MIN;
+}
+
+/*! Returns thread T's hold for RW, or a free hold if RW is NULL.  Returns
+    NULL if there is none. */
+static struct rwlock_hold *rwlock_find_hold(struct thread *t,
+                                            const struct rwlock *rw) {
+    int i;
+
+    for (i = 0; i < RWLOCK_HOLD_MAX; i++)
+        if (t->rwlocks[i].rwlock == rw)
+            return &t->rwlocks[i];
+    return NULL;
+}
+
+/*! Takes a free hold of the current thread for RW. */
+static struct rwlock_hold *rwlock_new_hold(struct rwlock *rw) {
+    struct thread *t = thread_current();
+    struct rwlock_hold *h;
+
+    ASSERT(rwlock_find_hold(t, rw) == NULL);
+    h = rwlock_find_hold(t, NULL);
+    if (h == NULL)
+        PANIC("%s holds too many reader-writer locks", t->name);
+    h->rwlock = rw;
+    h->thread = t;
+    return h;
+}
+
+/*! Raises the donated priority of thread T, which holds a lock, to
+    PRIORITY, and passes the donation on to the holders of any lock T is
+    waiting for. */
+static void donate_priority(struct thread *t, int priority, int nest_level) {
+    if (t->donated_priority < priority) {
+        t->donated_priority = priority;
+        thread_requeue(t);
+        if (nest_level < 8)
+            thread_update_locks(t, nest_level + 1);
+    }
+}
+
+/*! Donates RW's priority to the threads holding it. */
+static void rwlock_donate(struct rwlock *rw, int nest_level) {
+    struct list_elem *e;
+
+    if (rw->writer != NULL)
+        donate_priority(rw->writer, rw->priority, nest_level);
+    for (e = list_begin(&rw->readers); e != list_end(&rw->readers);
+         e = list_next(e))
+        donate_priority(list_entry(e, struct rwlock_hold, elem)->thread,
+                        rw->priority, nest_level);
+}
+
+/*! Recomputes the priority of RW from its waiting threads and donates it
+    to its holders.  Used when RW changes hands, or when the priority of a
+    thread waiting on it changes. */
+void rwlock_reset_priority(struct rwlock *rw, int nest_level) {
+    struct thread *t;
+
+    ASSERT(rw != NULL);
+
+    /* The waiters are kept in priority order. */
+    rw->priority = PRI_MIN;
+    if (!list_empty(&rw->read_queue.waiters)) {
+        t = list_entry(list_front(&rw->read_queue.waiters), struct thread,
+                       elem);
+        rw->priority = thread_effective_priority(t);
+    }
+    if (!list_empty(&rw->write_queue.waiters)) {
+        t = list_entry(list_front(&rw->write_queue.waiters), struct thread,
+                       elem);
+        if (thread_effective_priority(t) > rw->priority)
+            rw->priority = thread_effective_priority(t);
+    }
+    rwlock_donate(rw, nest_level);
+}
+
+/*! Blocks the current thread on QUEUE, one of RW's wait queues, until a
+    release hands it RW.  Interrupts must be off. */
+static void rwlock_wait(struct rwlock *rw, struct semaphore *queue) {
+    struct thread *cur = thread_current();
+
+    if (!thread_mlfqs && rw->priority < thread_get_priority()) {
+        rw->priority = thread_get_priority();
+        rwlock_donate(rw, 0);
+    }
+    cur->waiting_rwlock = rw;
+    cur->waiting_sema = queue;
+    list_insert_ordered(&queue->waiters, &cur->elem, waiter_before, NULL);
+    thread_block();
+    cur->waiting_rwlock = NULL;
+}
+
+/*! Wakes the first thread on QUEUE, without yielding to it, and returns
+    it. */
+static struct thread *rwlock_wake(struct semaphore *queue) {
+    struct thread *t;
+
+    t = list_entry(list_pop_front(&queue->waiters), struct thread, elem);
+    t->waiting_sema = NULL;
+    thread_unblock(t);
+    return t;
+}
+
+/*! Hands RW, which nobody holds, to the waiting writer with the highest
+    priority or, if no writer waits, to every waiting reader. */
+static void rwlock_grant(struct rwlock *rw) {
+    struct thread *t;
+
+    ASSERT(rw->writer == NULL && list_empty(&rw->readers));
+
+    if (!list_empty(&rw->write_queue.waiters))
+        rw->writer = rwlock_wake(&rw->write_queue);
+    else
+        while (!list_empty(&rw->read_queue.waiters)) {
+            t = rwlock_wake(&rw->read_queue);
+            list_push_back(&rw->readers, &rwlock_find_hold(t, rw)->elem);
+        }
+    if (!thread_mlfqs)
+        rwlock_reset_priority(rw, 0);
+}
+
+/*! Acquires RW for reading, sleeping while a writer holds it or waits for
+    it.  The current thread must not already hold RW.
+
+    This function may sleep, so it must not be called within an
+    interrupt handler. */
+void rwlock_acquire_read(struct rwlock *rw) {
+    enum intr_level old_level;
+    struct rwlock_hold *h;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+
+    old_level = intr_disable();
+    h = rwlock_new_hold(rw);
+    if (rw->writer == NULL && list_empty(&rw->write_queue.waiters))
+        list_push_back(&rw->readers, &h->elem);
+    else
+        rwlock_wait(rw, &rw->read_queue);
+    intr_set_level(old_level);
+}
+
+/*! Acquires RW for writing, sleeping while anyone else holds it.  The
+    current thread must not already hold RW.
+
+    This function may sleep, so it must not be called within an
+    interrupt handler. */
+void rwlock_acquire_write(struct rwlock *rw) {
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+
+    old_level = intr_disable();
+    rwlock_new_hold(rw);
+    if (rw->writer == NULL && list_empty(&rw->readers))
+        rw->writer = thread_current();
+    else
+        rwlock_wait(rw, &rw->write_queue);
+    intr_set_level(old_level);
+}
+
+/*! Gives up the current thread's hold H on RW, and any priority donated
+    through RW, after RW has been handed on if appropriate. */
+static void rwlock_drop_hold(struct rwlock_hold *h) {
+    h->rwlock = NULL;
+    if (!thread_mlfqs) {
+        thread_refund_priority();
+        thread_yield_to_higher();
+    }
+}
+
+/*! Releases RW, which the current thread must hold for reading. */
+void rwlock_release_read(struct rwlock *rw) {
+    enum intr_level old_level;
+    struct rwlock_hold *h;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+
+    old_level = intr_disable();
+    h = rwlock_find_hold(thread_current(), rw);
+    ASSERT(h != NULL && rw->writer != thread_current());
+    list_remove(&h->elem);
+    if (list_empty(&rw->readers))
+        rwlock_grant(rw);
+    rwlock_drop_hold(h);
+    intr_set_level(old_level);
+}
+
+/*! Releases RW, which the current thread must hold for writing. */
+void rwlock_release_write(struct rwlock *rw) {
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+    ASSERT(rw->writer == thread_current());
+
+    old_level = intr_disable();
+    rw->writer = NULL;
+    rwlock_grant(rw);
+    rwlock_drop_hold(rwlock_find_hold(thread_current(), rw));
+    intr_set_level(old_level);
+}
+
+/*! Returns true if the current thread holds RW for reading or writing. */
+bool rwlock_held_by_current_thread(const struct rwlock *rw) {
+    ASSERT(rw != NULL);
+
+    return rwlock_find_hold(thread_current(), rw) != NULL;
+}
+
 /*! One semaphore in a list. */
 struct semaphore_elem {
     struct list_elem elem;              /*!< List element. */
     struct semaphore semaphore;         /*!< This semaphore. */
+    struct thread *thread;              /*!< Thread waiting on it. */
 };
 
+/*! list_less_func that orders condition variable waiters like
+    waiter_before(), by the effective priority of each waiting thread.
+    thread_requeue() keeps the order current when a waiter's priority
+    changes. */
+static bool cond_waiter_before(const struct list_elem *a,
+                               const struct list_elem *b, void *aux UNUSED) {
+    const struct semaphore_elem *s1, *s2;
+
+    s1 = list_entry(a, struct semaphore_elem, elem);
+    s2 = list_entry(b, struct semaphore_elem, elem);
+    return (thread_effective_priority(s1->thread) >
+            thread_effective_priority(s2->thread));
+}
+
 /*! Initializes condition variable COND.  A condition variable
     allows one piece of code to signal a condition and cooperating
     code to receive the signal and act upon it. */
@@ -348,6 +695,7 @@ void cond_init(struct condition *cond) {
     we need to sleep. */
 void cond_wait(struct condition *cond, struct lock *lock) {
     struct semaphore_elem waiter;
+    enum intr_level old_level;
 
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
@@ -355,7 +703,13 @@ void cond_wait(struct condition *cond, struct lock *lock) {
     ASSERT(lock_held_by_current_thread(lock));
   
     sema_init(&waiter.semaphore, 0);
-    list_push_back(&cond->waiters, &waiter.elem);
+    waiter.thread = thread_current();
+    old_level = intr_disable();
+    waiter.thread->waiting_cond = cond;
+    waiter.thread->cond_elem = &waiter.elem;
+    list_insert_ordered(&cond->waiters, &waiter.elem, cond_waiter_before,
+                        NULL);
+    intr_set_level(old_level);
     lock_release(lock);
     sema_down(&waiter.semaphore);
     lock_acquire(lock);
@@ -369,36 +723,35 @@ void cond_wait(struct condition *cond, struct lock *lock) {
     make sense to try to signal a condition variable within an
     interrupt handler. */
 void cond_signal(struct condition *cond, struct lock *lock UNUSED) {
-    struct list_elem *s; 
+    struct semaphore_elem *s;
+    enum intr_level old_level;
 
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
     ASSERT(!intr_context ());
     ASSERT(lock_held_by_current_thread (lock));
 
+    old_level = intr_disable();
     if (!list_empty(&cond->waiters)) {
-        s = list_max(&cond->waiters, cond_prioritycomp, NULL);
-        list_remove(s);
-        sema_up(&list_entry(s, struct semaphore_elem, elem)->semaphore);
+        s = list_entry(list_pop_front(&cond->waiters), struct semaphore_elem,
+                       elem);
+        s->thread->waiting_cond = NULL;
+        sema_up(&s->semaphore);
     }
+    intr_set_level(old_level);
 }
 
-bool cond_prioritycomp(const struct list_elem *a, const struct list_elem *b,
-                       void *aux) {
-    struct semaphore *s1, *s2;
-    struct list_elem *t1, *t2;
-
-    s1 = &list_entry(a, struct semaphore_elem, elem)->semaphore;
-    t1 = list_front(&s1->waiters);
-    
-    s2 = &list_entry(b, struct semaphore_elem, elem)->semaphore;
-    t2 = list_front(&s2->waiters);
-
-    return (thread_prioritycomp(t1, t2, NULL));
+/*! Moves thread T, which is waiting on COND, to its place in COND's
+    waiters for its current effective priority.  Interrupts must be off,
+    since T's priority may change without COND's lock held. */
+void cond_requeue(struct condition *cond, struct thread *t) {
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(t->waiting_cond == cond);
 
+    list_remove(t->cond_elem);
+    list_insert_ordered(&cond->waiters, t->cond_elem, cond_waiter_before,
+                        NULL);
 }
-    
-    
 
 /*! Wakes up all threads, if any, waiting on COND (protected by
     LOCK).  LOCK must be held before calling this function.
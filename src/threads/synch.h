@@ -9,18 +9,24 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
+struct lockstat_entry;
 
 /*! A counting semaphore. */
 struct semaphore {
     unsigned value;             /*!< Current value. */
-    struct list waiters;        /*!< List of waiting threads. */
+    struct list waiters;        /*!< Waiting threads, highest priority first. */
 };
 
 void sema_init(struct semaphore *, unsigned value);
 void sema_down(struct semaphore *);
+bool sema_down_interruptible(struct semaphore *);
 bool sema_try_down(struct semaphore *);
 void sema_up(struct semaphore *);
 void sema_self_test(void);
+void sema_requeue(struct semaphore *, struct thread *);
 
 /*! Lock. */
 struct lock {
@@ -28,9 +34,12 @@ struct lock {
     struct semaphore semaphore; /*!< Binary semaphore controlling access. */
     struct list_elem elem;      /*!< List element */
     int priority;               /*!< Highest priority of the waiting threads. */
+    struct lockstat_entry *stats;   /*!< Contention statistics, or NULL. */
+    uint64_t acquired_at;       /*!< TSC when last acquired, if tracked. */
 };
 
 void lock_init(struct lock *);
+void lock_init_named(struct lock *, const char *name);
 void lock_acquire(struct lock *);
 bool lock_try_acquire(struct lock *);
 void lock_release(struct lock *);
@@ -40,18 +49,43 @@ bool lock_prioritycomp(const struct list_elem *a, const struct list_elem *b,
                        void *aux);
 void lock_reset_priority(struct lock *lock, int nest_level);
 
+/*! Most reader-writer locks one thread may hold or wait for at once. */
+#define RWLOCK_HOLD_MAX 4
+
+/*! Reader-writer lock. */
+struct rwlock {
+    struct thread *writer;      /*!< Thread holding it exclusively. */
+    struct list readers;        /*!< Holds of threads sharing it. */
+    struct semaphore read_queue;    /*!< Waiting readers; value stays 0. */
+    struct semaphore write_queue;   /*!< Waiting writers; value stays 0. */
+    int priority;               /*!< Highest priority of the waiting threads. */
+};
+
+/*! One thread's hold on a reader-writer lock, kept in struct thread. */
+struct rwlock_hold {
+    struct list_elem elem;      /*!< Element in the lock's readers. */
+    struct rwlock *rwlock;      /*!< Lock held or waited for, or NULL. */
+    struct thread *thread;      /*!< Thread this hold belongs to. */
+};
+
+void rwlock_init(struct rwlock *);
+void rwlock_acquire_read(struct rwlock *);
+void rwlock_release_read(struct rwlock *);
+void rwlock_acquire_write(struct rwlock *);
+void rwlock_release_write(struct rwlock *);
+bool rwlock_held_by_current_thread(const struct rwlock *);
+void rwlock_reset_priority(struct rwlock *, int nest_level);
+
 /*! Condition variable. */
 struct condition {
-    struct list waiters;        /*!< List of waiting threads. */
+    struct list waiters;        /*!< Waiters, highest priority first. */
 };
 
 void cond_init(struct condition *);
 void cond_wait(struct condition *, struct lock *);
 void cond_signal(struct condition *, struct lock *);
 void cond_broadcast(struct condition *, struct lock *);
-
-bool cond_prioritycomp(const struct list_elem *a, const struct list_elem *b,
-                       void *aux);
+void cond_requeue(struct condition *, struct thread *);
 
 /*! Optimization barrier.
 
@@ -9,6 +9,7 @@
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/schedtrace.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -27,9 +28,15 @@
     of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/*! List of processes in THREAD_READY state, that is, processes
-    that are ready to run but not actually running. */
-static struct list ready_list;
+/*! Processes in THREAD_READY state, that is, processes that are ready to
+    run but not actually running.  There is one FIFO queue per priority, and
+    bit P of ready_bitmap is set exactly when ready_queues[P] is not empty,
+    so the highest ready priority is found with a single bit scan.  Each
+    thread sits on the queue for its effective priority, so a ready thread
+    whose effective priority changes must be moved with thread_requeue(). */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_bitmap;
+static size_t ready_cnt;        /*!< Total number of ready threads. */
 
 /*! List of all processes.  Processes are added to this list
     when they are first scheduled and removed when they exit. */
@@ -44,6 +51,16 @@ static struct thread *initial_thread;
 /*! Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/*! Pages of exited threads kept for reuse by thread_create(), so that
+    creating a thread need not zero a whole page and destroying one need
+    not return it to palloc, which poisons it in debug builds.  Only the
+    struct thread at the bottom must start out clear, and init_thread()
+    clears it; the rest of the page is stack.  Accessed only with
+    interrupts off. */
+#define THREAD_CACHE_MAX 8
+static struct thread *thread_cache[THREAD_CACHE_MAX];
+static size_t thread_cache_cnt;
+
 
 /*! Stack frame for kernel_thread(). */
 struct kernel_thread_frame {
@@ -74,14 +91,36 @@ static struct thread *next_thread_to_run(void);
 static void init_thread(struct thread *, const char *name, int priority, 
                         tid_t tid);
 static bool is_thread(struct thread *) UNUSED;
+static void ready_push(struct thread *);
+static void ready_remove(struct thread *);
+static int ready_max_priority(void);
 static void *alloc_frame(struct thread *, size_t size);
-static void schedule(void);
+static void schedule(int reason);
+static void yield(int reason);
 void thread_schedule_tail(struct thread *prev);
 static tid_t allocate_tid(void);
+static struct thread *thread_page_get(void);
+static void thread_page_free(struct thread *);
 
 /*! The global load average of the system*/
 static int32_t load_avg;
 
+/*! Number of once-a-second MLFQS updates so far. */
+static unsigned mlfqs_seconds;
+
+/*! Decay coefficient 2*load_avg / (2*load_avg + 1) applied to recent_cpu
+    at each of the last DECAY_HISTORY seconds, indexed by second modulo
+    DECAY_HISTORY.  Blocked threads are brought up to date from it when they
+    wake, instead of every thread being visited each second.  A thread that
+    slept longer only gets the last DECAY_HISTORY decays, by which time its
+    old recent_cpu has decayed to almost nothing anyway. */
+#define DECAY_HISTORY 64
+static int32_t decay_history[DECAY_HISTORY];
+
+static void mlfqs_update_second(void);
+static void mlfqs_decay(struct thread *t);
+static int mlfqs_priority(const struct thread *t);
+
 /*! Initializes the threading system by transforming the code
     that's currently running into a thread.  This can't work in
     general and it is possible in this case only because loader.S
@@ -94,9 +133,14 @@ static int32_t load_avg;
 
     It is not safe to call thread_current() until this function finishes. */
 void thread_init(void) {
+    int i;
+
     ASSERT(intr_get_level() == INTR_OFF);
-    lock_init(&tid_lock);
-    list_init(&ready_list);
+    lock_init_named(&tid_lock, "tid");
+    for (i = PRI_MIN; i <= PRI_MAX; i++)
+        list_init(&ready_queues[i]);
+    ready_bitmap = 0;
+    ready_cnt = 0;
     list_init(&all_list);
     load_avg = 0;
 
@@ -144,19 +188,14 @@ void thread_tick(void) {
     }
     
     if (thread_mlfqs){
-        if (timer_ticks() % TIMER_FREQ == 0){
+        if (timer_ticks() % TIMER_FREQ == 0)
             /* When time passed as multiple of a second, then update
-            * load_avg and all thread's recent_cpu.*/
-            update_load_avg();
-        
-            thread_foreach(thread_update_recent_cpu, NULL);
-            
-        }
-        
-        if (timer_ticks() % 4 == 0)
-            /*For every fourth clock tick, update all priority.*/
-            thread_foreach(thread_update_priority, NULL);
-        
+            * load_avg and the recent_cpu of runnable threads.*/
+            mlfqs_update_second();
+        else if (timer_ticks() % 4 == 0 && t != idle_thread)
+            /* Only the running thread's recent_cpu has changed since the
+               last update, so only its priority can have changed. */
+            thread_update_priority(t, NULL);
     }
     
     
@@ -207,7 +246,7 @@ tid_t thread_create2(const char *name, int priority, thread_func *function,
     ASSERT(function != NULL);
 
     /* Allocate thread. */
-    t = palloc_get_page(PAL_ZERO);
+    t = thread_page_get();
     if (t == NULL)
         return TID_ERROR;
 
@@ -218,8 +257,15 @@ tid_t thread_create2(const char *name, int priority, thread_func *function,
 #ifdef USERPROG
     t->type = type;
     supp_table_init(&(t->s_table));
+    lock_init_named(&t->s_table_lock, "supp table");
     list_init(&(t->mmap_lst));
     t->stack_no = 0;
+    t->stack_top = PHYS_BASE;
+    t->stack_max = THREAD_MAX_STACK;
+    t->uthread_slots = 0;
+    t->uthread_cnt = 0;
+    sema_init(&t->uthread_exited, 0);
+    t->exiting = false;
     t->mmapid_max = 0;
     t->esp = NULL;
     t->syscall = false;
@@ -243,7 +289,7 @@ tid_t thread_create2(const char *name, int priority, thread_func *function,
     thread_unblock(t);
     
     if (priority > thread_get_priority())
-        thread_yield();
+        yield(SCHEDTRACE_PREEMPT);
     return tid;
 }
 
@@ -257,7 +303,40 @@ void thread_block(void) {
     ASSERT(intr_get_level() == INTR_OFF);
 
     thread_current()->status = THREAD_BLOCKED;
-    schedule();
+    schedule(SCHEDTRACE_BLOCK);
+}
+
+/*! Like thread_block(), but thread_interrupt() may also wake the thread.
+    The caller must check the thread's `interrupted' flag once awake, and
+    take the thread off any wait list other than a semaphore's. */
+void thread_block_interruptible(void) {
+    struct thread *cur = thread_current();
+
+    cur->interruptible = true;
+    thread_block();
+    cur->interruptible = false;
+}
+
+/*! Asks thread T to give up waiting, for good.  If T is asleep in
+    thread_block_interruptible() it is woken and taken off the waiters of
+    any semaphore it was blocked on, and its later interruptible waits
+    return at once. */
+void thread_interrupt(struct thread *t) {
+    enum intr_level old_level;
+
+    ASSERT(is_thread(t));
+
+    old_level = intr_disable();
+    t->interrupted = true;
+    if (t->status == THREAD_BLOCKED && t->interruptible) {
+        if (t->waiting_sema != NULL) {
+            list_remove(&t->elem);
+            t->waiting_sema = NULL;
+        }
+        t->interruptible = false;
+        thread_unblock(t);
+    }
+    intr_set_level(old_level);
 }
 
 /*! Transitions a blocked thread T to the ready-to-run state.  This is an
@@ -274,11 +353,20 @@ void thread_unblock(struct thread *t) {
 
     old_level = intr_disable();
     ASSERT(t->status == THREAD_BLOCKED);
-    list_push_back(&ready_list, &t->elem);
+    if (thread_mlfqs)
+        thread_update_recent_cpu(t, NULL);
+    ready_push(t);
     t->status = THREAD_READY;
+    schedtrace_wakeup(t, ready_cnt);
+    timer_runnable_changed();
     intr_set_level(old_level);
 }
 
+/*! Returns the number of threads waiting on the run queues. */
+size_t thread_ready_count(void) {
+    return ready_cnt;
+}
+
 /*! Returns the name of the running thread. */
 const char * thread_name(void) {
     return thread_current()->name;
@@ -342,7 +430,7 @@ void thread_exit(void) {
     ASSERT(!intr_context());
     t = thread_current();
 #ifdef USERPROG
-    if (t->type == THREAD_PROCESS)
+    if (t->type == THREAD_PROCESS || t->type == THREAD_UTHREAD)
         process_exit();
     /* Free all remaining opened files */
     while (!list_empty(&t->f_lst)) {
@@ -371,13 +459,36 @@ void thread_exit(void) {
     /*ASSERT(list_empty(&thread_current()->locks));*/
     list_remove(&t->allelem);
     t->status = THREAD_DYING;
-    schedule();
+    schedule(SCHEDTRACE_EXIT);
     NOT_REACHED();
 }
 
 /*! Yields the CPU.  The current thread is not put to sleep and
     may be scheduled again immediately at the scheduler's whim. */
 void thread_yield(void) {
+    yield(SCHEDTRACE_YIELD);
+}
+
+/*! Yields the CPU on behalf of the scheduler rather than the running
+    thread, because its time slice ran out or a higher-priority thread
+    became ready.  Called on return from an external interrupt. */
+void thread_preempt(void) {
+    yield(SCHEDTRACE_PREEMPT);
+}
+
+/*! Yields the CPU if a ready thread has a higher priority than the running
+    thread, as it may after the running thread gives up a donation. */
+void thread_yield_to_higher(void) {
+    enum intr_level old_level = intr_disable();
+
+    if (ready_max_priority() > thread_get_priority())
+        yield(SCHEDTRACE_PREEMPT);
+    intr_set_level(old_level);
+}
+
+/*! Puts the current thread back on the run queue and schedules, recording
+    REASON, SCHEDTRACE_YIELD or SCHEDTRACE_PREEMPT, in the scheduler trace. */
+static void yield(int reason) {
     struct thread *cur = thread_current();
     enum intr_level old_level;
 
@@ -385,9 +496,9 @@ void thread_yield(void) {
 
     old_level = intr_disable();
     if (cur != idle_thread) 
-        list_push_back(&ready_list, &cur->elem);
+        ready_push(cur);
     cur->status = THREAD_READY;
-    schedule();
+    schedule(reason);
     intr_set_level(old_level);
 }
 
@@ -407,7 +518,6 @@ void thread_foreach(thread_action_func *func, void *aux) {
 
 /*! Sets the current thread's priority to NEW_PRIORITY. */
 void thread_set_priority(int new_priority) {
-    struct thread *hp;
     enum intr_level old_level;
     int old_priority;
 
@@ -415,12 +525,9 @@ void thread_set_priority(int new_priority) {
     old_level = intr_disable();
     old_priority = thread_get_priority();
     thread_current()->priority = new_priority;
-    if (thread_get_priority() < old_priority && !list_empty(&ready_list)) {
-        hp = list_entry(list_max(&ready_list, thread_prioritycomp, NULL),
-                        struct thread, elem);
-        if (hp->priority > new_priority)
-            thread_yield();
-    }
+    if (thread_get_priority() < old_priority &&
+        ready_max_priority() > thread_get_priority())
+        thread_yield();
     intr_set_level(old_level);
 }
 
@@ -431,6 +538,8 @@ void thread_update_locks(struct thread *t, int nest_level) {
     if (t->waiting_lock) {
         lock_reset_priority(t->waiting_lock, nest_level); 
     }
+    if (t->waiting_rwlock)
+        rwlock_reset_priority(t->waiting_rwlock, nest_level);
 }
 
 /*! Returns the current thread's priority. */
@@ -442,9 +551,22 @@ int thread_get_priority(void) {
     return (p1 < p2 ? p2 : p1);
 }
 
+/*! Returns T's priority, taking donations into account. */
+int thread_effective_priority(const struct thread *t) {
+    return (t->priority < t->donated_priority ?
+            t->donated_priority : t->priority);
+}
+
 /*! Update the priority of the input thread. This is part of the BSD
  *  Scheduler. */
 static void thread_update_priority(struct thread* t, void* args UNUSED){
+    t->priority = mlfqs_priority(t);
+    thread_requeue(t);
+}
+
+/*! Returns the BSD scheduler priority of T given its recent_cpu and nice
+    values. */
+static int mlfqs_priority(const struct thread *t) {
     int p;
     
     p = PRI_MAX - F2IN(FDIVI(t->recent_cpu, 4)) - (t->nice) * 2; 
@@ -455,14 +577,13 @@ static void thread_update_priority(struct thread* t, void* args UNUSED){
     if (p < PRI_MIN)
         p = PRI_MIN;
     
-    t->priority = p;
-    
+    return p;
 }
 
 /*! Update the global variable load_avg*/
 static void update_load_avg(void) {
     /* First get the number of ready threads*/
-    size_t num_ready = list_size(&ready_list);
+    size_t num_ready = ready_cnt;
     if (thread_current()!=idle_thread 
           && thread_current()->status == THREAD_RUNNING)
         ++ num_ready;
@@ -473,14 +594,68 @@ static void update_load_avg(void) {
     load_avg = FMULF(load_avg, coeff);
     coeff = FMULI(FDIVI(coeff, 59), num_ready);
     load_avg += coeff;
-    
+
+    /* Every thread's recent_cpu decays by the same factor this second. */
+    coeff = FMULI(load_avg, 2);
+    mlfqs_seconds++;
+    decay_history[mlfqs_seconds % DECAY_HISTORY] =
+        FDIVF(coeff, FADDI(coeff, 1));
 }
 
-/*! Update the recent_cpu of the input thread.*/
-static void thread_update_recent_cpu(struct thread* t, void* args UNUSED){    
-    int32_t coeff1 = FMULI(load_avg, 2);
-    int32_t coeff2 = FDIVF(coeff1, FADDI(coeff1, 1));
-    t->recent_cpu = FADDI(FMULF(coeff2, t->recent_cpu), t->nice);
+/*! Update the recent_cpu of the input thread, and its priority with it, if
+    it has missed any once-a-second decays.*/
+static void thread_update_recent_cpu(struct thread* t, void* args UNUSED){
+    if (t->mlfqs_second != mlfqs_seconds) {
+        mlfqs_decay(t);
+        thread_update_priority(t, NULL);
+    }
+}
+
+/*! Applies to T's recent_cpu every once-a-second decay it has missed. */
+static void mlfqs_decay(struct thread *t) {
+    unsigned second = t->mlfqs_second;
+
+    if (mlfqs_seconds - second > DECAY_HISTORY)
+        second = mlfqs_seconds - DECAY_HISTORY;
+    while (second != mlfqs_seconds) {
+        second++;
+        t->recent_cpu = FADDI(FMULF(decay_history[second % DECAY_HISTORY],
+                                    t->recent_cpu), t->nice);
+    }
+    t->mlfqs_second = mlfqs_seconds;
+}
+
+/*! Once-a-second MLFQS update, run in the timer interrupt.  Updates
+    load_avg and decays the recent_cpu of the running thread and of every
+    ready thread, since those are the threads whose priority matters now.
+    Blocked threads catch up in thread_unblock(). */
+static void mlfqs_update_second(void) {
+    static struct list runnable;
+    struct thread *cur = thread_current();
+    int p;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+    update_load_avg();
+    if (cur != idle_thread)
+        thread_update_recent_cpu(cur, NULL);
+
+    /* Take every ready thread off the run queues, highest priority first,
+       and queue it again at its new priority.  Threads that end up at
+       the same priority keep their relative order. */
+    list_init(&runnable);
+    for (p = PRI_MAX; p >= PRI_MIN; p--)
+        if (!list_empty(&ready_queues[p]))
+            list_splice(list_end(&runnable), list_begin(&ready_queues[p]),
+                        list_end(&ready_queues[p]));
+    ready_bitmap = 0;
+    ready_cnt = 0;
+    while (!list_empty(&runnable)) {
+        struct thread *t = list_entry(list_pop_front(&runnable),
+                                      struct thread, elem);
+        mlfqs_decay(t);
+        t->priority = mlfqs_priority(t);
+        ready_push(t);
+    }
 }
 
 /*! Sets the current thread's nice value to NICE. */
@@ -522,6 +697,7 @@ int thread_get_recent_cpu(void) {
 static void idle(void *idle_started_ UNUSED) {
     struct semaphore *idle_started = idle_started_;
     idle_thread = thread_current();
+    schedtrace_set_idle(idle_thread);
     sema_up(idle_started);
 
     for (;;) {
@@ -594,6 +770,7 @@ static void init_thread(struct thread *t, const char *name, int priority,
             t->nice = thread_current()->nice;
             t->recent_cpu = thread_current()->recent_cpu;   
         }
+        t->mlfqs_second = mlfqs_seconds;
         
         thread_update_priority(t, NULL);
         
@@ -604,6 +781,7 @@ static void init_thread(struct thread *t, const char *name, int priority,
     t->magic = THREAD_MAGIC;
     list_init(&t->locks); 
     t->waiting_lock = NULL;
+    t->waiting_cond = NULL;
     old_level = intr_disable();
 #ifdef USERPROG
 
@@ -617,6 +795,7 @@ static void init_thread(struct thread *t, const char *name, int priority,
         trs->pid = (pid_t)t->tid;
         sema_init(&trs->sem, 0);
         sema_init(&trs->exec_sem, 0);
+        trs->uthread = false;
         t->trs = trs;
         list_push_back(&(thread_current()->child_returnstats), &trs->elem);
         list_push_back(&thread_current()->child_processes, &t->child_elem);
@@ -629,6 +808,7 @@ static void init_thread(struct thread *t, const char *name, int priority,
             t->cur_dir = dir_reopen(t->parent->cur_dir);
     }
     list_init(&t->child_processes);
+    t->proc = t;
     t->f_exe = NULL;
     t->orphan = false;
 
@@ -655,19 +835,77 @@ static void * alloc_frame(struct thread *t, size_t size) {
     run queue is empty, return idle_thread. */
 static struct thread * next_thread_to_run(void) {
     struct thread * nt;
-    enum intr_level old_level;
 
-    if (list_empty(&ready_list)) {
+    ASSERT(intr_get_level() == INTR_OFF);
+    if (ready_bitmap == 0)
         return idle_thread;
+
+    nt = list_entry(list_front(&ready_queues[ready_max_priority()]),
+                    struct thread, elem);
+    ready_remove(nt);
+    return nt;
+}
+
+/*! Returns the index of the most significant set bit of nonzero X. */
+static inline int bit_scan_reverse(uint32_t x) {
+    uint32_t index;
+    asm ("bsrl %1, %0" : "=r" (index) : "rm" (x));
+    return index;
+}
+
+/*! Returns the highest priority of any ready thread, or PRI_MIN - 1 if no
+    thread is ready. */
+static int ready_max_priority(void) {
+    uint32_t hi = ready_bitmap >> 32, lo = ready_bitmap;
+
+    if (hi != 0)
+        return 32 + bit_scan_reverse(hi);
+    if (lo != 0)
+        return bit_scan_reverse(lo);
+    return PRI_MIN - 1;
+}
+
+/*! Appends T to the run queue for its effective priority.  Interrupts must
+    be off. */
+static void ready_push(struct thread *t) {
+    int p = thread_effective_priority(t);
+
+    ASSERT(intr_get_level() == INTR_OFF);
+    t->ready_priority = p;
+    list_push_back(&ready_queues[p], &t->elem);
+    ready_bitmap |= (uint64_t) 1 << p;
+    ready_cnt++;
+}
+
+/*! Removes T from its run queue.  Interrupts must be off. */
+static void ready_remove(struct thread *t) {
+    int p = t->ready_priority;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+    list_remove(&t->elem);
+    if (list_empty(&ready_queues[p]))
+        ready_bitmap &= ~((uint64_t) 1 << p);
+    ready_cnt--;
+}
+
+/*! Moves T to its place for its current effective priority in the queue
+    it waits on: its run queue if T is ready, or the waiters of the
+    semaphore it is blocked on, and in the waiters of the condition
+    variable it waits on, if any.  Must be called after any change to the
+    priority or donated priority of a thread that may be waiting. */
+void thread_requeue(struct thread *t) {
+    enum intr_level old_level = intr_disable();
+
+    if (t->status == THREAD_READY &&
+        t->ready_priority != thread_effective_priority(t)) {
+        ready_remove(t);
+        ready_push(t);
     }
-    else {
-        old_level = intr_disable();
-        nt = list_entry(list_max(&ready_list, thread_prioritycomp, NULL), 
-                        struct thread, elem);
-        list_remove(&nt->elem);
-        intr_set_level(old_level);
-        return nt;
-    }
+    else if (t->status == THREAD_BLOCKED && t->waiting_sema != NULL)
+        sema_requeue(t->waiting_sema, t);
+    if (t->waiting_cond != NULL)
+        cond_requeue(t->waiting_cond, t);
+    intr_set_level(old_level);
 }
 
 /*! Completes a thread switch by activating the new thread's page tables, and,
@@ -707,17 +945,18 @@ void thread_schedule_tail(struct thread *prev) {
     if (prev != NULL && prev->status == THREAD_DYING &&
         prev != initial_thread) {
         ASSERT(prev != cur);
-        palloc_free_page(prev);
+        thread_page_free(prev);
     }
 }
 
 /*! Schedules a new process.  At entry, interrupts must be off and the running
     process's state must have been changed from running to some other state.
-    This function finds another thread to run and switches to it.
+    This function finds another thread to run and switches to it.  REASON,
+    one of the SCHEDTRACE_* reasons, says why the running thread stopped.
 
     It's not safe to call printf() until thread_schedule_tail() has
     completed. */
-static void schedule(void) {
+static void schedule(int reason) {
     struct thread *cur = running_thread();
     struct thread *next = next_thread_to_run();
     struct thread *prev = NULL;
@@ -726,37 +965,11 @@ static void schedule(void) {
     ASSERT(cur->status != THREAD_RUNNING);
     ASSERT(is_thread(next));
 
-    if (cur != next)
+    if (cur != next) {
+        schedtrace_switch(cur, next, reason, ready_cnt);
         prev = switch_threads(cur, next);
-    thread_schedule_tail(prev);
-}
-
-/*! List_leff_func for priority scheduling. This function compares to list
-    elements that belong to two threads based on the threads' priority. 
-    Note that donated_priority is also taken into account. */
-
-bool thread_prioritycomp(const struct list_elem *a, const struct list_elem *b,
-                         void *aux) {
-    enum intr_level old_level;
-    int p1, p2;
-    struct thread *t1, *t2;
-
-    old_level = intr_disable();
-    t1 = list_entry(a, struct thread, elem);
-    t2 = list_entry(b, struct thread, elem);
-    p1 = t1->priority;
-    if (p1 < t1->donated_priority) {
-        p1 = t1->donated_priority;
     }
-
-    p2 = t2->priority;
-    if (p2 < t2->donated_priority) {
-        p2 = t2->donated_priority;
-    }
-    
-    intr_set_level(old_level);
-
-    return (p1 < p2);
+    thread_schedule_tail(prev);
 }
 
 /*! Reset the donated_priority of the thread. This function is called when
@@ -766,8 +979,10 @@ bool thread_prioritycomp(const struct list_elem *a, const struct list_elem *b,
 
 void thread_refund_priority(void) {
     struct lock *l;
+    struct rwlock *rw;
     enum intr_level old_level;
     struct thread *ct;
+    int i;
 
     old_level = intr_disable();
     ct = thread_current();
@@ -780,9 +995,42 @@ void thread_refund_priority(void) {
                    struct lock, elem);
         ct->donated_priority = l->priority;
     }
+    for (i = 0; i < RWLOCK_HOLD_MAX; i++) {
+        rw = ct->rwlocks[i].rwlock;
+        if (rw != NULL && rw->priority > ct->donated_priority)
+            ct->donated_priority = rw->priority;
+    }
     intr_set_level(old_level);
 }     
 
+/*! Returns a page for a new thread, from the cache of pages of exited
+    threads if it holds any, or a null pointer if memory is exhausted.  The
+    page's contents are arbitrary. */
+static struct thread *thread_page_get(void) {
+    struct thread *t = NULL;
+    enum intr_level old_level;
+
+    old_level = intr_disable();
+    if (thread_cache_cnt > 0)
+        t = thread_cache[--thread_cache_cnt];
+    intr_set_level(old_level);
+
+    return t != NULL ? t : palloc_get_page(0);
+}
+
+/*! Frees the page of exited thread T, keeping it for reuse if the cache
+    has room.  Interrupts must be off. */
+static void thread_page_free(struct thread *t) {
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    /* A stale pointer to T must not pass is_thread(). */
+    t->magic = 0;
+    if (thread_cache_cnt < THREAD_CACHE_MAX)
+        thread_cache[thread_cache_cnt++] = t;
+    else
+        palloc_free_page(t);
+}
+
 /*! Returns a tid to use for a new thread. */
 static tid_t allocate_tid(void) {
     static tid_t next_tid = 1;
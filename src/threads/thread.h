@@ -37,6 +37,12 @@ typedef int mapid_t;
 #define PRI_MAX 63                      /*!< Highest priority. */
 #define THREAD_MAX_STACK 2047
 
+/*! Most threads a user process may run besides its initial one, and the
+    pages each of their stacks may grow to.  Their stacks lie one after
+    another below the initial thread's. */
+#define UTHREAD_MAX 32
+#define UTHREAD_MAX_STACK 256
+
 
 /*! A kernel thread or user process.
 
@@ -102,6 +108,7 @@ typedef int mapid_t;
 enum thread_type {
     THREAD_KERNEL,
     THREAD_PROCESS,
+    THREAD_UTHREAD,                     /*!< Another thread of a process. */
 };
 
 struct thread_return_status {
@@ -112,6 +119,8 @@ struct thread_return_status {
     struct list_elem elem;
     int load_success;                  /*!< Indicate whether executable file 
                                              is successfully loaded */
+    bool uthread;                      /*!< Belongs to a thread of the
+                                            parent's own process */
 };
 
 struct thread {
@@ -123,28 +132,47 @@ struct thread {
     uint8_t *stack;                     /*!< Saved stack pointer. */
     int nice;                           /*!< Niceness of the thread.*/
     int32_t recent_cpu;                     /*!< Recent_cpu of the thread */
+    unsigned mlfqs_second;              /*!< Last second recent_cpu decayed. */
     int priority;                       /*!< Intrinsic Priority. */
     int donated_priority;               /*!< Priority donated by other threads.*/
+    int ready_priority;                 /*!< Run queue holding a ready thread. */
     struct list_elem allelem;           /*!< List element for all threads list. */
     struct list_elem elem;              /*!< List element */
+    bool interrupted;                   /*!< thread_interrupt() was called */
+    bool interruptible;                 /*!< In thread_block_interruptible() */
     /**@}*/
 
     /*! Shared between thread.c and synch.c. */
     /**@{*/
     struct lock * waiting_lock;         /*!< The lock that the thread is waiting on. */
+    struct semaphore *waiting_sema;     /*!< Semaphore the thread is blocked on. */
+    struct condition *waiting_cond;     /*!< Condition variable waited on. */
+    struct list_elem *cond_elem;        /*!< Its element in waiting_cond. */
+    struct rwlock *waiting_rwlock;      /*!< Reader-writer lock waited for. */
+    struct rwlock_hold rwlocks[RWLOCK_HOLD_MAX];  /*!< Reader-writer locks held. */
 
     /**@}*/
 
-    int64_t wakeup_time;                /*!< Wake up time of the thread */
-
     struct list locks;                  /*!< List of locks acquired by the thread */
     struct dir * cur_dir;
 #ifdef USERPROG
     /*! Owned by userprog/process.c. */
     /**@{*/
     uint32_t *pagedir;                  /*!< Page directory. */
+    struct thread *proc;                /*!< Thread holding the process's
+                                             shared state; itself unless
+                                             this is a THREAD_UTHREAD */
     struct hash s_table;                /*! Supplemental page table*/
+    struct lock s_table_lock;           /*! Serializes s_table and mmap_lst */
     uint32_t stack_no;                  /*! total number of stack of PGSIZE allocated */
+    uint8_t *stack_top;                 /*!< Top of this thread's user stack */
+    uint32_t stack_max;                 /*!< Most pages the stack may have */
+    int uthread_slot;                   /*!< Stack region of a THREAD_UTHREAD */
+    uint32_t uthread_slots;             /*!< Stack regions in use, a bit each */
+    int uthread_cnt;                    /*!< THREAD_UTHREADs still running */
+    struct semaphore uthread_exited;    /*!< Upped as each of them exits */
+    bool exiting;                       /*!< Some thread has called exit() */
+    int exit_status;                    /*!< Status given to that exit() */
     struct list mmap_lst;               /*! The list for mmap structs */
     mapid_t mmapid_max;
     bool syscall;
@@ -161,6 +189,7 @@ struct thread {
     enum thread_type type;              /*!< PROCESS or KERNEL */
     struct file* f_exe;                 /*!< Currently opened executable file */
     bool orphan;                        /*!< Whether parent has perished */
+    struct aio_context *aio;            /*!< Asynchronous I/O rings, if any */
 
 #endif
     /*! Owned by thread.c. */
@@ -205,7 +234,10 @@ tid_t thread_create2(const char *name, int priority, thread_func *, void *,
 tid_t thread_create(const char *name, int priority, thread_func *, void *);
 
 void thread_block(void);
+void thread_block_interruptible(void);
 void thread_unblock(struct thread *);
+void thread_interrupt(struct thread *);
+size_t thread_ready_count(void);
 
 struct thread *thread_current (void);
 tid_t thread_tid(void);
@@ -215,9 +247,11 @@ struct thread_return_status *thread_findchild(pid_t pid);
 
 void thread_exit(void) NO_RETURN;
 void thread_yield(void);
+void thread_preempt(void);
+void thread_yield_to_higher(void);
 
-bool thread_prioritycomp(const struct list_elem *a, const struct list_elem *b, 
-                         void *aux);
+int thread_effective_priority(const struct thread *t);
+void thread_requeue(struct thread *t);
 
 void thread_refund_priority(void);
 void thread_update_locks(struct thread *t, int nest_level);
@@ -0,0 +1,245 @@
+/*! \file workqueue.c
+
+   Workqueues run deferred work in a fixed pool of kernel threads, so that
+   a subsystem that wants something done in the background, periodically or
+   after a delay does not need threads of its own.  Work can be queued from
+   interrupt handlers, including timer callbacks, so the queue is protected
+   by turning interrupts off rather than by a lock, and workers wait on a
+   semaphore that is upped once for each item queued.  An item cancelled
+   before a worker took it leaves an extra up behind, which the worker just
+   skips.  Semaphores are only upped after interrupts are restored, since
+   sema_up() may yield the CPU. */
+
+#include "threads/workqueue.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/*! Workqueue for subsystems that do not need their own workers. */
+struct workqueue system_wq;
+
+/*! A thread waiting in workqueue_flush(). */
+struct flusher {
+    struct list_elem elem;      /*!< Element in workqueue's flushers. */
+    struct semaphore done;      /*!< Upped when the workqueue is idle. */
+};
+
+static void worker(void *wq_);
+static void delayed_expired(void *work_);
+
+/*! Initializes WQ and starts WORKER_CNT worker threads for it at
+    PRIORITY.  NAME must remain valid forever, as a string literal does. */
+void workqueue_init(struct workqueue *wq, const char *name, int worker_cnt,
+                    int priority) {
+    int i;
+
+    ASSERT(wq != NULL && name != NULL);
+    ASSERT(worker_cnt > 0);
+
+    wq->name = name;
+    list_init(&wq->pending);
+    wq->busy = 0;
+    list_init(&wq->flushers);
+    sema_init(&wq->ready, 0);
+    for (i = 0; i < worker_cnt; i++)
+        if (thread_create(name, priority, worker, wq) == TID_ERROR)
+            PANIC("%s: cannot start worker", name);
+}
+
+/*! Initializes W to run FUNC(AUX) when queued.  Among the items pending on
+    a workqueue, those with a higher PRIORITY run first, and items of equal
+    priority run in the order they were queued. */
+void work_init(struct work *w, work_func *func, void *aux, int priority) {
+    ASSERT(w != NULL && func != NULL);
+
+    w->func = func;
+    w->aux = aux;
+    w->priority = priority;
+    w->state = WORK_IDLE;
+    w->wq = NULL;
+    timer_setup(&w->timer, delayed_expired, w);
+}
+
+/*! Returns true if work A should run before work B. */
+static bool work_before(const struct list_elem *a_,
+                        const struct list_elem *b_, void *aux UNUSED) {
+    const struct work *a = list_entry(a_, struct work, elem);
+    const struct work *b = list_entry(b_, struct work, elem);
+
+    return a->priority > b->priority;
+}
+
+/*! Puts W on WQ's pending list.  Interrupts must be off.  The caller
+    must up WQ's ready semaphore after restoring them. */
+static void enqueue(struct workqueue *wq, struct work *w) {
+    w->state = WORK_PENDING;
+    w->wq = wq;
+    list_insert_ordered(&wq->pending, &w->elem, work_before, NULL);
+    wq->busy++;
+}
+
+/*! Queues W to run on WQ.  Returns false, doing nothing, if W was already
+    delayed or pending.  May be called from an interrupt handler. */
+bool workqueue_queue(struct workqueue *wq, struct work *w) {
+    enum intr_level old_level;
+    bool queued = false;
+
+    old_level = intr_disable();
+    if (w->state == WORK_IDLE) {
+        enqueue(wq, w);
+        queued = true;
+    }
+    intr_set_level(old_level);
+    if (queued)
+        sema_up(&wq->ready);
+    return queued;
+}
+
+/*! Queues W to run on WQ after TICKS timer ticks, or at once if TICKS is
+    not positive.  Returns false, doing nothing, if W was already delayed or
+    pending.  May be called from an interrupt handler. */
+bool workqueue_queue_delayed(struct workqueue *wq, struct work *w,
+                             int64_t ticks) {
+    enum intr_level old_level;
+    bool queued = false;
+
+    if (ticks <= 0)
+        return workqueue_queue(wq, w);
+
+    old_level = intr_disable();
+    if (w->state == WORK_IDLE) {
+        w->state = WORK_DELAYED;
+        w->wq = wq;
+        timer_add(&w->timer, timer_ticks() + ticks);
+        queued = true;
+    }
+    intr_set_level(old_level);
+    return queued;
+}
+
+/*! Timer callback for delayed work WORK_. */
+static void delayed_expired(void *work_) {
+    struct work *w = work_;
+    struct workqueue *wq = w->wq;
+    enum intr_level old_level;
+    bool queued = false;
+
+    old_level = intr_disable();
+    if (w->state == WORK_DELAYED) {
+        enqueue(wq, w);
+        queued = true;
+    }
+    intr_set_level(old_level);
+    if (queued)
+        sema_up(&wq->ready);
+}
+
+/*! If WQ has become idle, moves the threads in its workqueue_flush() to
+    WOKEN, which the caller must pass to wake_flushers() after restoring
+    interrupts.  Interrupts must be off. */
+static void take_flushers(struct workqueue *wq, struct list *woken) {
+    list_init(woken);
+    if (wq->busy == 0 && !list_empty(&wq->flushers))
+        list_splice(list_end(woken), list_begin(&wq->flushers),
+                    list_end(&wq->flushers));
+}
+
+/*! Wakes the flushers in WOKEN, as taken by take_flushers(). */
+static void wake_flushers(struct list *woken) {
+    while (!list_empty(woken)) {
+        struct flusher *f = list_entry(list_pop_front(woken),
+                                       struct flusher, elem);
+        sema_up(&f->done);
+    }
+}
+
+/*! Cancels W if it is delayed or pending.  Returns true if it was, false
+    if it was idle or a worker already took it, in which case it may still
+    be running. */
+bool workqueue_cancel(struct work *w) {
+    struct workqueue *wq;
+    enum intr_level old_level;
+    struct list woken;
+    bool cancelled = false;
+
+    /* W->wq only changes while W is idle, and a timer callback cannot
+       run while interrupts are off. */
+    old_level = intr_disable();
+    wq = w->wq;
+    list_init(&woken);
+    if (wq != NULL) {
+        if (w->state == WORK_DELAYED) {
+            timer_cancel(&w->timer);
+            cancelled = true;
+        }
+        else if (w->state == WORK_PENDING) {
+            list_remove(&w->elem);
+            wq->busy--;
+            take_flushers(wq, &woken);
+            cancelled = true;
+        }
+        if (cancelled) {
+            w->state = WORK_IDLE;
+            w->wq = NULL;
+        }
+    }
+    intr_set_level(old_level);
+    wake_flushers(&woken);
+    return cancelled;
+}
+
+/*! Waits until WQ has no work pending or running.  Work that is still
+    delayed is not waited for. */
+void workqueue_flush(struct workqueue *wq) {
+    enum intr_level old_level;
+    struct flusher f;
+
+    ASSERT(!intr_context());
+
+    old_level = intr_disable();
+    if (wq->busy == 0) {
+        intr_set_level(old_level);
+        return;
+    }
+    sema_init(&f.done, 0);
+    list_push_back(&wq->flushers, &f.elem);
+    intr_set_level(old_level);
+    sema_down(&f.done);
+}
+
+/*! Main function of a worker thread for workqueue WQ_. */
+static void worker(void *wq_) {
+    struct workqueue *wq = wq_;
+    enum intr_level old_level;
+
+    for (;;) {
+        struct list woken;
+        work_func *func;
+        struct work *w;
+        void *aux;
+
+        sema_down(&wq->ready);
+        old_level = intr_disable();
+        if (list_empty(&wq->pending)) {
+            /* The item this up was for was cancelled. */
+            intr_set_level(old_level);
+            continue;
+        }
+        w = list_entry(list_pop_front(&wq->pending), struct work, elem);
+        func = w->func;
+        aux = w->aux;
+        w->state = WORK_IDLE;
+        w->wq = NULL;
+        intr_set_level(old_level);
+
+        /* From here on W belongs to its owner again, who may requeue or
+           free it inside FUNC. */
+        func(aux);
+
+        old_level = intr_disable();
+        wq->busy--;
+        take_flushers(wq, &woken);
+        intr_set_level(old_level);
+        wake_flushers(&woken);
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "devices/timer.h"
+#include "threads/synch.h"
+
+/*! Function run by a worker thread for a work item.  It runs in a kernel
+    thread, so unlike a timer_func it may sleep. */
+typedef void work_func(void *aux);
+
+/*! States of a work item. */
+enum work_state {
+    WORK_IDLE,                  /*!< Not queued. */
+    WORK_DELAYED,               /*!< Waiting for its timer. */
+    WORK_PENDING                /*!< Queued for a worker. */
+};
+
+/*! A piece of deferred work.  The owner embeds it in a longer-lived
+    structure, initializes it with work_init() and hands it to a workqueue.
+    Once a worker has taken it off the queue the owner may queue it again
+    or free it, even from within FUNC. */
+struct work {
+    struct list_elem elem;      /*!< Element in workqueue's pending list. */
+    work_func *func;            /*!< Function to run. */
+    void *aux;                  /*!< Argument for FUNC. */
+    int priority;               /*!< Higher runs first. */
+    enum work_state state;      /*!< Owned by the workqueue. */
+    struct workqueue *wq;       /*!< Queue while delayed or pending. */
+    struct timer timer;         /*!< Timer for delayed work. */
+};
+
+/*! A queue of work items served by a fixed pool of worker threads. */
+struct workqueue {
+    const char *name;           /*!< Name, also given to the workers. */
+    struct list pending;        /*!< Queued items, highest priority first. */
+    unsigned busy;              /*!< Items pending or running. */
+    struct list flushers;       /*!< Threads in workqueue_flush(). */
+    struct semaphore ready;     /*!< Upped for each item queued. */
+};
+
+/*! Number of worker threads serving system_wq. */
+#define SYSTEM_WQ_WORKERS 2
+
+/*! Workqueue for subsystems that do not need their own workers. */
+extern struct workqueue system_wq;
+
+void workqueue_init(struct workqueue *, const char *name, int worker_cnt,
+                    int priority);
+void work_init(struct work *, work_func *, void *aux, int priority);
+bool workqueue_queue(struct workqueue *, struct work *);
+bool workqueue_queue_delayed(struct workqueue *, struct work *,
+                             int64_t ticks);
+bool workqueue_cancel(struct work *);
+void workqueue_flush(struct workqueue *);
+
+#endif /* threads/workqueue.h */
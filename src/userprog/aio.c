@@ -0,0 +1,388 @@
+#include "userprog/aio.h"
+#include <debug.h>
+#include <list.h>
+#include <stdio.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "threads/workqueue.h"
+#include "filesys/file.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+
+/*! Most pages a buffer of AIO_MAX_LEN bytes can touch. */
+#define AIO_MAX_PAGES (AIO_MAX_LEN / PGSIZE + 1)
+
+/*! One read or write handed to the worker threads.  The user buffer is
+    pinned and translated to kernel addresses at submission time, so a
+    worker can reach it without the owner's page directory being active. */
+struct aio_request {
+    struct work work;                   /*!< Work item on aio_wq */
+    struct aio_context *ctx;            /*!< Context to complete into */
+    uint32_t opcode;                    /*!< AIO_OP_READ or AIO_OP_WRITE */
+    uint32_t user_data;                 /*!< Echoed in the completion */
+    struct file *file;                  /*!< Private reopen of the file */
+    off_t offset;                       /*!< Byte offset within the file */
+    size_t len;                         /*!< Length of the transfer */
+    uint8_t *ubuf;                      /*!< User address of the buffer */
+    size_t page_cnt;                    /*!< Number of pages in the buffer */
+    struct supp_table *pages[AIO_MAX_PAGES];    /*!< Pinned user pages */
+    uint8_t *kpages[AIO_MAX_PAGES];     /*!< Their kernel addresses */
+};
+
+/*! Workqueue serving the requests, with its own workers so that slow
+    file I/O cannot hold up other deferred work. */
+static struct workqueue aio_wq;
+static struct lock aio_start_lock;
+static bool aio_started;
+
+static void aio_run(void *r_);
+
+/*! Initializes the module.  The workqueue is started by the first
+    aio_setup(). */
+void aio_init(void) {
+    lock_init_named(&aio_start_lock, "aio start");
+    aio_started = false;
+}
+
+/*! Maps a zeroed ring page at user address UPAGE for the current process.
+    Returns false if the process already has a ring or UPAGE is not a free,
+    page-aligned user address. */
+bool aio_setup(void *upage) {
+    struct thread *t = thread_current()->proc;
+    struct aio_context *ctx;
+    struct supp_table *st;
+    struct frame_table_entry *fr;
+
+    ASSERT(sizeof(struct aio_ring) <= PGSIZE);
+
+    if (upage == NULL || pg_ofs(upage) != 0 || !is_user_vaddr(upage))
+        return false;
+    supp_table_lock();
+    if (t->aio != NULL || find_supp_table(upage) != NULL) {
+        supp_table_unlock();
+        return false;
+    }
+
+    ctx = malloc(sizeof *ctx);
+    if (ctx == NULL) {
+        supp_table_unlock();
+        return false;
+    }
+    st = create_aio_supp_table(upage);
+    if (st == NULL) {
+        supp_table_unlock();
+        free(ctx);
+        return false;
+    }
+
+    /* The ring page is pinned, so the frame never moves. */
+    fr = obtain_frame(PAL_USER | PAL_ZERO, st);
+    st->fr = fr;
+    if (!install_page(upage, fr->physical_addr, true)) {
+        spte_destructor_func(&st->elem, NULL);
+        supp_table_unlock();
+        free(ctx);
+        return false;
+    }
+
+    ctx->ring = fr->physical_addr;
+    ctx->pagedir = t->pagedir;
+    ctx->sq_head = 0;
+    ctx->cq_tail = 0;
+    ctx->inflight = 0;
+    lock_init(&ctx->lock);
+    cond_init(&ctx->completed);
+    t->aio = ctx;
+    supp_table_unlock();
+
+    lock_acquire(&aio_start_lock);
+    if (!aio_started) {
+        workqueue_init(&aio_wq, "aio worker", AIO_WORKERS, PRI_DEFAULT);
+        aio_started = true;
+    }
+    lock_release(&aio_start_lock);
+    return true;
+}
+
+/*! Posts a completion for USER_DATA with result RES.  The caller must hold
+    CTX->lock and have counted the submission in CTX->inflight. */
+static void aio_complete(struct aio_context *ctx, uint32_t user_data,
+                         int32_t res) {
+    struct aio_cqe *cqe = &ctx->ring->cqes[ctx->cq_tail % AIO_CQ_ENTRIES];
+
+    cqe->user_data = user_data;
+    cqe->res = res;
+    /* The entry must be in place before the process can see it. */
+    barrier();
+    ctx->ring->cq_tail = ++ctx->cq_tail;
+    ctx->inflight--;
+    cond_broadcast(&ctx->completed, &ctx->lock);
+}
+
+/*! Faults in every page of the LEN bytes at UBUF and checks that each is
+    a user page, and writable if TO_USER is set because the kernel will
+    store into the buffer.  Kills the process on a bad buffer, so it is
+    called before anything is allocated or pinned for the request. */
+static void aio_check_buffer(uint8_t *ubuf, size_t len, bool to_user) {
+    struct supp_table *st;
+    uint8_t *upage;
+    bool bad;
+
+    for (upage = pg_round_down(ubuf); upage < ubuf + len; upage += PGSIZE) {
+        /* Touching the page runs the usual fault path, which brings it
+           in or grows the stack, and kills us if it is not valid. */
+        (void) *(volatile uint8_t *) upage;
+
+        supp_table_lock();
+        st = find_supp_table(upage);
+        bad = st == NULL || (to_user && !st->writable);
+        supp_table_unlock();
+        if (bad)
+            exit(-1);
+    }
+}
+
+/*! Drops the pins that aio_pin_pages() has taken so far on R's pages. */
+static void aio_unpin_pages(struct aio_request *r) {
+    size_t i;
+
+    lock_acquire(&f_table.lock);
+    for (i = 0; i < r->page_cnt; i++)
+        r->pages[i]->io_pins--;
+    lock_release(&f_table.lock);
+    r->page_cnt = 0;
+}
+
+/*! Pins and translates every page of R's user buffer, which
+    aio_check_buffer() has already vetted.  Returns false, leaving nothing
+    pinned, if a page has gone away since, as when another thread of the
+    process unmaps it. */
+static bool aio_pin_pages(struct aio_request *r, bool to_user) {
+    struct thread *t = thread_current();
+    struct supp_table *st;
+    uint8_t *upage, *kpage;
+
+    r->page_cnt = 0;
+    for (upage = pg_round_down(r->ubuf); upage < r->ubuf + r->len;
+         upage += PGSIZE) {
+        do {
+            supp_table_lock();
+            st = find_supp_table(upage);
+            if (st == NULL || (to_user && !st->writable)) {
+                supp_table_unlock();
+                aio_unpin_pages(r);
+                return false;
+            }
+
+            /* Pin under the frame table lock, so that an eviction cannot
+               be half done when we check that the page is present. */
+            lock_acquire(&f_table.lock);
+            kpage = pagedir_get_page(t->pagedir, upage);
+            if (kpage != NULL)
+                st->io_pins++;
+            lock_release(&f_table.lock);
+            supp_table_unlock();
+
+            /* Evicted since it was checked, so fault it back in. */
+            if (kpage == NULL)
+                (void) *(volatile uint8_t *) upage;
+        } while (kpage == NULL);
+
+        r->pages[r->page_cnt] = st;
+        r->kpages[r->page_cnt] = kpage;
+        r->page_cnt++;
+    }
+    return true;
+}
+
+/*! Turns submission SQE into a request for the workers.  Returns NULL if
+    the submission completes at once, with its result stored in *RES. */
+static struct aio_request *aio_prepare(const struct aio_sqe *sqe, int *res) {
+    struct aio_request *r;
+    struct f_info *f;
+
+    *res = -1;
+    if (sqe->opcode == AIO_OP_NOP) {
+        *res = 0;
+        return NULL;
+    }
+    if (sqe->opcode != AIO_OP_READ && sqe->opcode != AIO_OP_WRITE)
+        return NULL;
+
+    /* The console has no notion of an offset. */
+    if (sqe->len > AIO_MAX_LEN ||
+        sqe->fd == STDIN_FILENO || sqe->fd == STDOUT_FILENO)
+        return NULL;
+
+    f = findfile(sqe->fd);
+    if (f->isdir)
+        return NULL;
+    if (sqe->len == 0) {
+        *res = 0;
+        return NULL;
+    }
+    if (!checkva(sqe->buf) || !checkva((uint8_t *) sqe->buf + sqe->len))
+        exit(-1);
+    aio_check_buffer(sqe->buf, sqe->len, sqe->opcode == AIO_OP_READ);
+
+    r = malloc(sizeof *r);
+    if (r == NULL)
+        return NULL;
+    r->file = file_reopen(f->f);
+    if (r->file == NULL) {
+        free(r);
+        return NULL;
+    }
+
+    r->ctx = thread_current()->proc->aio;
+    r->opcode = sqe->opcode;
+    r->user_data = sqe->user_data;
+    r->offset = sqe->offset;
+    r->len = sqe->len;
+    r->ubuf = sqe->buf;
+    if (!aio_pin_pages(r, r->opcode == AIO_OP_READ)) {
+        file_close(r->file);
+        free(r);
+        exit(-1);
+    }
+    return r;
+}
+
+/*! Consumes up to TO_SUBMIT entries from the current process's submission
+    ring, then waits until at least MIN_COMPLETE completions are ready to
+    reap or nothing is left in flight.  Submission stops early when the
+    ring is empty or the completion ring could overflow.  Returns the
+    number of entries consumed, or -1 if the process has no ring. */
+int aio_enter(unsigned to_submit, unsigned min_complete) {
+    struct aio_context *ctx = thread_current()->proc->aio;
+    struct aio_ring *ring;
+    struct aio_request *r;
+    struct aio_sqe sqe;
+    uint32_t queued, pending;
+    unsigned submitted = 0;
+    int res;
+
+    if (ctx == NULL)
+        return -1;
+    ring = ctx->ring;
+
+    while (submitted < to_submit) {
+        /* The ring indices are in user memory, so never trust them
+           beyond what the kernel's own copies allow. */
+        lock_acquire(&ctx->lock);
+        queued = ring->sq_tail - ctx->sq_head;
+        pending = ctx->cq_tail - ring->cq_head;
+        if (queued == 0 || queued > AIO_SQ_ENTRIES ||
+            pending > AIO_CQ_ENTRIES ||
+            ctx->inflight + pending >= AIO_CQ_ENTRIES) {
+            lock_release(&ctx->lock);
+            break;
+        }
+        sqe = ring->sqes[ctx->sq_head % AIO_SQ_ENTRIES];
+        lock_release(&ctx->lock);
+
+        /* May fault in user pages or kill the process, so no locks. */
+        r = aio_prepare(&sqe, &res);
+
+        lock_acquire(&ctx->lock);
+        ring->sq_head = ++ctx->sq_head;
+        ctx->inflight++;
+        if (r == NULL)
+            aio_complete(ctx, sqe.user_data, res);
+        lock_release(&ctx->lock);
+
+        if (r != NULL) {
+            work_init(&r->work, aio_run, r, PRI_DEFAULT);
+            workqueue_queue(&aio_wq, &r->work);
+        }
+        submitted++;
+    }
+
+    lock_acquire(&ctx->lock);
+    while (ctx->inflight > 0 &&
+           ctx->cq_tail - ring->cq_head < min_complete)
+        cond_wait(&ctx->completed, &ctx->lock);
+    lock_release(&ctx->lock);
+
+    return submitted;
+}
+
+/*! Waits for the current process's outstanding requests and releases its
+    context.  The ring page itself goes away with the rest of the
+    supplemental page table. */
+void aio_exit(void) {
+    struct thread *t = thread_current();
+    struct aio_context *ctx = t->aio;
+
+    if (ctx == NULL)
+        return;
+
+    lock_acquire(&ctx->lock);
+    while (ctx->inflight > 0)
+        cond_wait(&ctx->completed, &ctx->lock);
+    lock_release(&ctx->lock);
+
+    t->aio = NULL;
+    free(ctx);
+}
+
+/*! Performs request R one page of the buffer at a time and returns the
+    number of bytes transferred. */
+static int aio_transfer(struct aio_request *r) {
+    size_t done = 0, i;
+
+    for (i = 0; i < r->page_cnt && done < r->len; i++) {
+        size_t page_ofs = (i == 0) ? pg_ofs(r->ubuf) : 0;
+        size_t chunk = PGSIZE - page_ofs;
+        off_t n;
+
+        if (chunk > r->len - done)
+            chunk = r->len - done;
+
+        if (r->opcode == AIO_OP_READ)
+            n = file_read_at(r->file, r->kpages[i] + page_ofs, chunk,
+                             r->offset + done);
+        else
+            n = file_write_at(r->file, r->kpages[i] + page_ofs, chunk,
+                              r->offset + done);
+        done += n;
+
+        /* Stop at end of file. */
+        if ((size_t) n < chunk)
+            break;
+    }
+    return done;
+}
+
+/*! Carries out request R_ in an aio_wq worker and completes it */
+static void aio_run(void *r_) {
+    struct aio_request *r = r_;
+    uint8_t *upage;
+    size_t i;
+    int res;
+
+    res = aio_transfer(r);
+    file_close(r->file);
+
+    /* The kernel wrote through its own mapping, so the user pages'
+       dirty bits have to be set by hand before they are unpinned. */
+    lock_acquire(&f_table.lock);
+    upage = pg_round_down(r->ubuf);
+    for (i = 0; i < r->page_cnt; i++, upage += PGSIZE) {
+        if (r->opcode == AIO_OP_READ)
+            pagedir_set_dirty(r->ctx->pagedir, upage, true);
+        r->pages[i]->io_pins--;
+    }
+    lock_release(&f_table.lock);
+
+    lock_acquire(&r->ctx->lock);
+    aio_complete(r->ctx, r->user_data, res);
+    lock_release(&r->ctx->lock);
+    free(r);
+}
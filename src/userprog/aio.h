@@ -0,0 +1,26 @@
+#ifndef USERPROG_AIO_H
+#define USERPROG_AIO_H
+
+#include <aio.h>
+#include <stdbool.h>
+#include "threads/synch.h"
+
+#define AIO_WORKERS 4           /* Kernel threads serving the request queue */
+
+/*! Per-process asynchronous I/O state, created by aio_setup(). */
+struct aio_context {
+    struct aio_ring *ring;      /*!< Kernel address of the shared ring page */
+    uint32_t *pagedir;          /*!< Page directory of the owning process */
+    uint32_t sq_head;           /*!< Kernel's copy of ring->sq_head */
+    uint32_t cq_tail;           /*!< Kernel's copy of ring->cq_tail */
+    int inflight;               /*!< Submissions without a completion yet */
+    struct lock lock;           /*!< Protects the fields above */
+    struct condition completed; /*!< Signalled on every completion */
+};
+
+void aio_init(void);
+bool aio_setup(void *upage);
+int aio_enter(unsigned to_submit, unsigned min_complete);
+void aio_exit(void);
+
+#endif /* userprog/aio.h */
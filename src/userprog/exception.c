@@ -163,17 +163,28 @@ static void page_fault(struct intr_frame *f) {
         /* If not right violation, and fault_addr is in the user space,
            then it may be a page fault require loading new data. */
         
+        /* The process's threads share the supplemental page table, so
+           only one of them handles a fault at a time.  If another thread
+           brought the page in while we waited, we are done. */
+        supp_table_lock();
+        if (t->pagedir != NULL &&
+            pagedir_get_page(t->pagedir, pg_round_down(fault_addr))) {
+            supp_table_unlock();
+            return;
+        }
+
         /* First find out the supplemental page entry*/
         st = find_supp_table(pg_round_down(fault_addr));
         if (!st) {
             /* If not found, then if the fault address is around
-               esp, and above the maximum possilble stack address,
+               esp, and inside this thread's stack region,
                then we will allocate a new stack page. */
             stack_no = thread_current()->stack_no;
             if ((uint32_t)esp - 32 <= (uint32_t)fault_addr &&
-                (uint32_t)fault_addr >= PHYS_BASE - THREAD_MAX_STACK \
-                                                    * PGSIZE) {
-                if (thread_current()->stack_no < THREAD_MAX_STACK) {
+                (uint8_t *)fault_addr >= t->stack_top - t->stack_max \
+                                                    * PGSIZE &&
+                (uint8_t *)fault_addr < t->stack_top) {
+                if (thread_current()->stack_no < t->stack_max) {
                     /* If the current thread has less than the max number 
                        of stacks, then create a stack supplemental page entry. 
                      */
@@ -190,6 +201,7 @@ static void page_fault(struct intr_frame *f) {
                         st->writable)) {
                         exit(-1);
                     }
+                    supp_table_unlock();
                     return;
                 }
                 /* We already have max number of stacks for the process, 
@@ -236,6 +248,7 @@ static void page_fault(struct intr_frame *f) {
             exit(-1);
         }
         st->pinned = false;
+        supp_table_unlock();
     } else {
 
         /* To implement virtual memory, delete the rest of the function
@@ -0,0 +1,201 @@
+/*! \file futex.c
+
+   Fast user-space mutexes.  A futex is any aligned 32-bit word of user
+   memory.  User code manipulates it with atomic instructions and only
+   makes a system call to sleep until the word changes or to wake
+   sleepers, so an uncontended lock never enters the kernel.
+
+   Sleepers are kept in a hash table of wait queues, keyed by the physical
+   address of the word, so that processes sharing a frame share its
+   futexes.  A sleeper pins the page holding the word for as long as it
+   sleeps, so the frame cannot be evicted and the key stays valid, and a
+   waker that finds the page absent knows nobody sleeps on it and returns
+   without faulting it in. */
+
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+
+/*! Number of wait queues.  Must be a power of 2. */
+#define FUTEX_BUCKETS 64
+
+/*! A thread sleeping in futex_wait(). */
+struct futex_waiter {
+    struct list_elem elem;      /*!< Element in futex_bucket's waiters. */
+    uintptr_t key;              /*!< Physical address of the word. */
+    struct thread *proc;        /*!< Process of the sleeping thread. */
+    struct semaphore woken;     /*!< Upped by futex_wake(). */
+};
+
+/*! A wait queue, shared by every futex whose key hashes to it. */
+struct futex_bucket {
+    struct lock lock;           /*!< Protects WAITERS. */
+    struct list waiters;        /*!< Sleepers, oldest first. */
+};
+
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+
+/*! Initializes the wait queues. */
+void futex_init(void) {
+    int i;
+
+    for (i = 0; i < FUTEX_BUCKETS; i++) {
+        lock_init_named(&buckets[i].lock, "futex bucket");
+        list_init(&buckets[i].waiters);
+    }
+}
+
+/*! Returns the wait queue for KEY. */
+static struct futex_bucket *bucket_for(uintptr_t key) {
+    return &buckets[hash_int(key >> 2) & (FUTEX_BUCKETS - 1)];
+}
+
+/*! Pins the page holding the word at UADDR, and returns the word's
+    kernel address, storing the page's entry in *ST.  A page that is not
+    resident is faulted in if FAULT is set, and otherwise left alone and a
+    null pointer returned.  Kills the process if UADDR is not a valid,
+    aligned user address. */
+static uint32_t *futex_pin(uint32_t *uaddr, bool fault,
+                           struct supp_table **st) {
+    uint8_t *upage = pg_round_down(uaddr);
+    uint8_t *kpage;
+
+    if ((uintptr_t) uaddr % sizeof *uaddr != 0 || !checkva(uaddr))
+        exit(-1);
+    do {
+        /* Touching the word runs the usual fault path, which brings the
+           page in, and kills us if it is not valid. */
+        if (fault)
+            (void) *(volatile uint32_t *) uaddr;
+
+        supp_table_lock();
+        *st = find_supp_table(upage);
+        if (*st == NULL)
+            exit(-1);
+
+        /* Pin under the frame table lock, so that an eviction cannot be
+           half done when we check that the page is present. */
+        lock_acquire(&f_table.lock);
+        kpage = pagedir_get_page(thread_current()->pagedir, upage);
+        if (kpage != NULL)
+            (*st)->io_pins++;
+        lock_release(&f_table.lock);
+        supp_table_unlock();
+    } while (kpage == NULL && fault);
+
+    if (kpage == NULL)
+        return NULL;
+    return (uint32_t *) (kpage + pg_ofs(uaddr));
+}
+
+/*! Undoes futex_pin() for the page with entry ST. */
+static void futex_unpin(struct supp_table *st) {
+    lock_acquire(&f_table.lock);
+    st->io_pins--;
+    lock_release(&f_table.lock);
+}
+
+/*! If the word at UADDR still holds EXPECTED, sleeps until futex_wake()
+    is called for it and returns 0.  Otherwise returns -1 at once, since
+    the caller's view of the word is out of date.  The check and going to
+    sleep are atomic with respect to futex_wake(), so a wakeup that follows
+    the change the caller waits for cannot be missed. */
+int futex_wait(uint32_t *uaddr, uint32_t expected) {
+    struct futex_waiter w;
+    struct futex_bucket *b;
+    struct supp_table *st;
+    uint32_t *kaddr;
+
+    kaddr = futex_pin(uaddr, true, &st);
+    w.key = vtop(kaddr);
+    b = bucket_for(w.key);
+
+    /* A process that is exiting wakes its sleepers once, under the bucket
+       locks, so none may go to sleep after that. */
+    lock_acquire(&b->lock);
+    if (*(volatile uint32_t *) kaddr != expected ||
+        thread_current()->proc->exiting) {
+        lock_release(&b->lock);
+        futex_unpin(st);
+        return -1;
+    }
+    w.proc = thread_current()->proc;
+    sema_init(&w.woken, 0);
+    list_push_back(&b->waiters, &w.elem);
+    lock_release(&b->lock);
+
+    sema_down(&w.woken);
+    futex_unpin(st);
+    return 0;
+}
+
+/*! Wakes up to CNT threads sleeping on the word at UADDR, oldest first,
+    and returns how many were woken. */
+int futex_wake(uint32_t *uaddr, int cnt) {
+    struct futex_bucket *b;
+    struct supp_table *st;
+    struct list_elem *e;
+    uint32_t *kaddr;
+    uintptr_t key;
+    int woken = 0;
+
+    /* Sleepers keep their page resident, so if it is absent there is
+       nobody to wake. */
+    kaddr = futex_pin(uaddr, false, &st);
+    if (kaddr == NULL)
+        return 0;
+    key = vtop(kaddr);
+    b = bucket_for(key);
+
+    lock_acquire(&b->lock);
+    for (e = list_begin(&b->waiters);
+         e != list_end(&b->waiters) && woken < cnt; ) {
+        struct futex_waiter *w = list_entry(e, struct futex_waiter, elem);
+        if (w->key == key) {
+            e = list_remove(e);
+            sema_up(&w->woken);
+            woken++;
+        }
+        else
+            e = list_next(e);
+    }
+    lock_release(&b->lock);
+
+    futex_unpin(st);
+    return woken;
+}
+
+/*! Wakes every thread of process PROC that sleeps on a futex, so that the
+    process's threads notice that it is exiting.  PROC->exiting must
+    already be set. */
+void futex_wake_process(struct thread *proc) {
+    struct list_elem *e;
+    int i;
+
+    ASSERT(proc->exiting);
+
+    for (i = 0; i < FUTEX_BUCKETS; i++) {
+        struct futex_bucket *b = &buckets[i];
+
+        lock_acquire(&b->lock);
+        for (e = list_begin(&b->waiters); e != list_end(&b->waiters); ) {
+            struct futex_waiter *w = list_entry(e, struct futex_waiter, elem);
+            if (w->proc == proc) {
+                e = list_remove(e);
+                sema_up(&w->woken);
+            }
+            else
+                e = list_next(e);
+        }
+        lock_release(&b->lock);
+    }
+}
@@ -9,6 +9,8 @@
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
+#include "userprog/aio.h"
+#include "userprog/futex.h"
 #include "userprog/syscall.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
@@ -24,6 +26,11 @@
 #include "vm/page.h"
 
 static thread_func start_process NO_RETURN;
+static thread_func start_thread NO_RETURN;
+static int reap_child(struct thread_return_status *trs);
+static void release_children(struct thread *cur);
+static void uthread_exit(struct thread *cur);
+static thread_action_func interrupt_sibling;
 static bool load(const char *cmdline, void (**eip)(void), void **esp);
 static bool arg_pass(const char *cmdline, void **esp);
 static bool push4(char** stack_ptr, void* val, void** esp);
@@ -109,17 +116,27 @@ static void start_process(void *file_name_) {
     free the trs struct.
  */
 int process_wait(tid_t child_tid) {
-    struct thread *cur;
     struct thread_return_status *trs;
-    enum intr_level old_level;
-    int status;
 
     trs = thread_findchild(child_tid);
-    cur = thread_current();
-    if (!trs)
+    if (!trs || trs->uthread)
         return -1;
+    return reap_child(trs);
+}
+
+/*! Waits for the child with return status TRS to die, frees TRS and
+    returns the child's exit status.  If the caller's process starts
+    exiting meanwhile, returns -1 at once and leaves TRS for
+    release_children() to free. */
+static int reap_child(struct thread_return_status *trs) {
+    enum intr_level old_level;
+    int status;
+
     old_level = intr_disable();
-    sema_down(&trs->sem);
+    if (!sema_down_interruptible(&trs->sem)) {
+        intr_set_level(old_level);
+        return -1;
+    }
     status = trs->stat;
     list_remove(&trs->elem);
     free(trs);
@@ -132,17 +149,28 @@ int process_wait(tid_t child_tid) {
     it not an orphan. 
  */
 void process_exit(void) {
-    struct thread_return_status *trs;
     struct thread *cur = thread_current();
-    struct thread *ct;
     uint32_t *pd;
     enum intr_level old_level;
     struct list_elem *ce;
     struct mmap_elem *cm;
 
+    /* A thread killed in the middle of a page fault or mmap() still holds
+       the lock on the shared page table. */
+    if (lock_held_by_current_thread(&cur->proc->s_table_lock))
+        lock_release(&cur->proc->s_table_lock);
+    if (cur->type == THREAD_UTHREAD) {
+        uthread_exit(cur);
+        return;
+    }
+
+    /* Stop the other threads before taking their address space away. */
+    process_set_exiting(-1);
+    while (cur->uthread_cnt > 0)
+        sema_down(&cur->uthread_exited);
+
     /* Destroy the current process's page directory and switch back
        to the kernel-only page directory. */
-    trs = NULL;
     if (cur->parent) {
         old_level = intr_disable();
         cur->trs->stat = -1;
@@ -152,28 +180,10 @@ void process_exit(void) {
     if (cur->type == THREAD_PROCESS)
         printf("%s: exit(%d)\n", cur->name, cur->trs->stat);
 
-    /* Signal parent if there is any; otherwise free the return_status */
-    if (!cur->orphan) {
-        sema_up(&cur->trs->sem);
-        list_remove(&cur->child_elem);
-    } else {
-        free(cur->trs);
-    }
-    /* Tell all the childs that they have become orphans */
-    old_level = intr_disable();
-    while (!list_empty(&cur->child_processes)) {
-        ct = list_entry(list_pop_front(&cur->child_processes), struct thread,
-                        child_elem);
-        ct->orphan = true;
-    }
-    /* Free any unretrieved thread_return_status from childs */
-    while (!list_empty(&cur->child_returnstats)) {
-        trs = list_entry(list_pop_front(&cur->child_returnstats), 
-                        struct thread_return_status, elem);
-        free(trs);
-    }
-    
-    intr_set_level(old_level);
+    release_children(cur);
+
+    /* Let outstanding asynchronous I/O finish before its pages go away */
+    aio_exit();
     while (!list_empty(&cur->mmap_lst)) {
         ce = list_begin(&(cur->mmap_lst));
         cm = list_entry(ce, struct mmap_elem, elem);
@@ -205,6 +215,77 @@ void process_exit(void) {
     }
 }
 
+/*! Marks the current process as exiting with STATUS, unless one of its
+    threads already has, and interrupts its other threads.  Each of them
+    gives up whatever it waits for and leaves on its next return to user
+    mode, which process_check_exiting() catches. */
+void process_set_exiting(int status) {
+    struct thread *proc = thread_current()->proc;
+    enum intr_level old_level;
+
+    old_level = intr_disable();
+    if (!proc->exiting) {
+        proc->exiting = true;
+        proc->exit_status = status;
+    }
+    thread_foreach(interrupt_sibling, proc);
+    intr_set_level(old_level);
+
+    /* Futex sleepers are not on a semaphore of their own choosing. */
+    futex_wake_process(proc);
+}
+
+/*! Interrupts thread T if it belongs to process PROC and is not the
+    current thread.  A thread_action_func for process_set_exiting(). */
+static void interrupt_sibling(struct thread *t, void *proc) {
+    if (t->proc == proc && t != thread_current())
+        thread_interrupt(t);
+}
+
+/*! Ends the current thread, which is about to return to user mode, if
+    another thread of its process has called exit() or been killed.
+    Called on the way out of every interrupt taken from user mode,
+    including the timer interrupts that preempt a thread looping there. */
+void process_check_exiting(void) {
+    struct thread *proc = thread_current()->proc;
+
+    if (proc->exiting) {
+        intr_enable();
+        exit(proc->exit_status);
+    }
+}
+
+/*! Signals CUR's parent if there is any, and otherwise frees CUR's return
+    status, then tells CUR's children that they have become orphans. */
+static void release_children(struct thread *cur) {
+    struct thread_return_status *trs;
+    struct thread *ct;
+    enum intr_level old_level;
+
+    /* Signal parent if there is any; otherwise free the return_status */
+    if (!cur->orphan) {
+        sema_up(&cur->trs->sem);
+        list_remove(&cur->child_elem);
+    } else {
+        free(cur->trs);
+    }
+    /* Tell all the childs that they have become orphans */
+    old_level = intr_disable();
+    while (!list_empty(&cur->child_processes)) {
+        ct = list_entry(list_pop_front(&cur->child_processes), struct thread,
+                        child_elem);
+        ct->orphan = true;
+    }
+    /* Free any unretrieved thread_return_status from childs */
+    while (!list_empty(&cur->child_returnstats)) {
+        trs = list_entry(list_pop_front(&cur->child_returnstats), 
+                        struct thread_return_status, elem);
+        free(trs);
+    }
+    
+    intr_set_level(old_level);
+}
+
 /*! Sets up the CPU for running user code in the current thread.
     This function is called on every context switch. */
 void process_activate(void) {
@@ -487,17 +568,20 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
     return true;
 }
 
-/*! Create a minimal stack by mapping a zeroed page at the top of
-    user virtual memory. */
+/*! Create a minimal stack by mapping a zeroed page at the top of the
+    current thread's stack region, which for a process's initial thread is
+    the top of user virtual memory. */
 static bool setup_stack(void **esp) {
     
     struct frame_table_entry *fr;
     struct supp_table * st;
+    uint8_t *top = thread_current()->stack_top;
     bool success = false;
     
     ASSERT(thread_current()->stack_no == 0);
     /* Create a new stack supplemental page table. */
-    st = create_stack_supp_table(((uint8_t*) PHYS_BASE) - PGSIZE);
+    supp_table_lock();
+    st = create_stack_supp_table(top - PGSIZE);
     
     /* Directly obtain the frame, as this is a the first stack for this 
      * process. Also set up the supplemental page table's frame, and
@@ -507,12 +591,12 @@ static bool setup_stack(void **esp) {
     thread_current()->stack_no = 1;
     
     /* Install the page.*/
-    success = install_page(((uint8_t *) PHYS_BASE) - PGSIZE, 
-                           fr->physical_addr, true);
+    success = install_page(top - PGSIZE, fr->physical_addr, true);
+    supp_table_unlock();
     
     /* Setup the stack pointer. */
     if (success)
-        *esp = PHYS_BASE ;
+        *esp = top;
     return success;
 }
 
@@ -663,3 +747,172 @@ static void get_prog_name(const char* cmdline, char* prog_name){
         /* Otherwise, the entire cmdline is prog_name */
         strlcpy(prog_name, cmdline, strlen(cmdline) + 1);
 }
+
+/*! What process_thread_create() hands to start_thread(). */
+struct thread_start {
+    struct thread *proc;        /*!< Process the new thread belongs to. */
+    int slot;                   /*!< Stack region claimed for it. */
+    void (*eip)(void);          /*!< User function to start in. */
+    void *func;                 /*!< First argument for EIP. */
+    void *aux;                  /*!< Second argument for EIP. */
+};
+
+/*! Starts another thread in the current process, which calls the user
+    function EIP with arguments FUNC and AUX on a stack of its own.  Returns
+    the new thread's id, or TID_ERROR if the process already has
+    UTHREAD_MAX other threads, is exiting, or memory runs out. */
+tid_t process_thread_create(void (*eip)(void), void *func, void *aux) {
+    struct thread *proc = thread_current()->proc;
+    struct thread_return_status *trs;
+    struct thread_start ts;
+    enum intr_level old_level;
+    tid_t tid;
+
+    /* Claim a stack region.  Counting the thread in now keeps the
+       process from going away before it runs. */
+    old_level = intr_disable();
+    for (ts.slot = 0; ts.slot < UTHREAD_MAX; ts.slot++)
+        if (!(proc->uthread_slots & (1u << ts.slot)))
+            break;
+    if (ts.slot == UTHREAD_MAX || proc->exiting) {
+        intr_set_level(old_level);
+        return TID_ERROR;
+    }
+    proc->uthread_slots |= 1u << ts.slot;
+    proc->uthread_cnt++;
+    intr_set_level(old_level);
+
+    ts.proc = proc;
+    ts.eip = eip;
+    ts.func = func;
+    ts.aux = aux;
+    tid = thread_create2(proc->name, PRI_DEFAULT, start_thread, &ts,
+                         THREAD_UTHREAD);
+    if (tid == TID_ERROR) {
+        old_level = intr_disable();
+        proc->uthread_slots &= ~(1u << ts.slot);
+        proc->uthread_cnt--;
+        intr_set_level(old_level);
+        sema_up(&proc->uthread_exited);
+        return TID_ERROR;
+    }
+
+    /* TS lives on our stack, so wait until the thread is done with it. */
+    trs = thread_findchild(tid);
+    sema_down(&trs->exec_sem);
+    if (trs->load_success == -1) {
+        reap_child(trs);
+        return TID_ERROR;
+    }
+    return tid;
+}
+
+/*! A thread function that joins a process and starts running it in user
+    mode with the arguments given to process_thread_create(). */
+static void start_thread(void *ts_) {
+    struct thread_start *ts = ts_;
+    struct thread *cur = thread_current();
+    struct intr_frame if_;
+    char *sp;
+    bool success;
+
+    /* Share the process's address space, files and mappings, and take a
+       stack region below the initial thread's. */
+    cur->proc = ts->proc;
+    cur->pagedir = ts->proc->pagedir;
+    cur->uthread_slot = ts->slot;
+    cur->stack_top = (uint8_t *) PHYS_BASE - (THREAD_MAX_STACK +
+                     ts->slot * UTHREAD_MAX_STACK) * PGSIZE;
+    cur->stack_max = UTHREAD_MAX_STACK;
+    cur->trs->uthread = true;
+    process_activate();
+
+    memset(&if_, 0, sizeof(if_));
+    if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+    if_.cs = SEL_UCSEG;
+    if_.eflags = FLAG_IF | FLAG_MBS;
+    if_.eip = ts->eip;
+
+    /* Call EIP(FUNC, AUX) with a null return address. */
+    success = setup_stack(&if_.esp);
+    if (success) {
+        sp = if_.esp;
+        success = push4(&sp, ts->aux, &if_.esp) &&
+                  push4(&sp, ts->func, &if_.esp) &&
+                  push4(&sp, NULL, &if_.esp);
+        if_.esp = sp;
+    }
+
+    cur->trs->load_success = success ? 0 : -1;
+    sema_up(&cur->trs->exec_sem);
+    if (!success)
+        thread_exit();
+
+    asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+    NOT_REACHED();
+}
+
+/*! Waits for thread TID of the current process to end and returns the
+    status it gave thread_exit(), or -1 if it was killed.  Returns -1 at
+    once if TID was not created by the calling thread or has already been
+    joined. */
+int process_thread_join(tid_t tid) {
+    struct thread_return_status *trs;
+
+    trs = thread_findchild(tid);
+    if (!trs || !trs->uthread)
+        return -1;
+    return reap_child(trs);
+}
+
+/*! Ends the current thread with STATUS for process_thread_join() to
+    collect.  Ending a process's initial thread ends the process, as
+    exit() does. */
+void process_thread_exit(int status) {
+    struct thread *cur = thread_current();
+
+    if (cur->type != THREAD_UTHREAD)
+        exit(status);
+    cur->trs->stat = status;
+    cur->parent = NULL;
+    thread_exit();
+}
+
+/*! Releases what the additional thread CUR holds of its own: its place
+    among its creator's children, its stack pages and its stack region.
+    The rest of the process is left to the initial thread. */
+static void uthread_exit(struct thread *cur) {
+    struct thread *proc = cur->proc;
+    struct supp_table *st;
+    enum intr_level old_level;
+    uint8_t *upage;
+
+    if (cur->parent) {
+        old_level = intr_disable();
+        cur->trs->stat = -1;
+        intr_set_level(old_level);
+    }
+    release_children(cur);
+
+    supp_table_lock();
+    lock_acquire(&f_table.lock);
+    for (upage = cur->stack_top - cur->stack_max * PGSIZE;
+         upage < cur->stack_top; upage += PGSIZE) {
+        st = find_supp_table(upage);
+        if (st != NULL)
+            spte_destructor_func(&st->elem, NULL);
+    }
+    lock_release(&f_table.lock);
+    supp_table_unlock();
+    hash_destroy(&cur->s_table, NULL);
+
+    /* The page directory belongs to the initial thread. */
+    cur->pagedir = NULL;
+    pagedir_activate(NULL);
+
+    old_level = intr_disable();
+    proc->uthread_slots &= ~(1u << cur->uthread_slot);
+    proc->uthread_cnt--;
+    intr_set_level(old_level);
+    sema_up(&proc->uthread_exited);
+}
@@ -7,6 +7,13 @@ tid_t process_execute(const char *file_name);
 int process_wait(tid_t);
 void process_exit(void);
 void process_activate(void);
+void process_set_exiting(int status);
+void process_check_exiting(void);
+
+/* Additional threads of a process. */
+tid_t process_thread_create(void (*eip)(void), void *func, void *aux);
+int process_thread_join(tid_t);
+void process_thread_exit(int status) NO_RETURN;
 
 /* load() helpers. */
 bool install_page(void *upage, void *kpage, bool writable);
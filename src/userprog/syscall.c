@@ -1,9 +1,11 @@
 #include "userprog/syscall.h"
 #include "userprog/process.h"
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
+#include "threads/lockstat.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
@@ -12,8 +14,10 @@
 #include "filesys/inode.h"
 #include "filesys/directory.h"
 #include "filesys/free-map.h"
+#include "devices/block.h"
 #include "devices/input.h"
 #include "devices/shutdown.h"
+#include "userprog/futex.h"
 #include "userprog/pagedir.h"
 #include "vm/page.h"
 #include "vm/frame.h"
@@ -21,6 +25,9 @@
 
 static void syscall_handler(struct intr_frame *);
 bool checkva(const void* va);
+static void checkbuf(const void *buffer, unsigned size, bool writing);
+static int copy_iovec(const struct iovec *iov, int iovcnt,
+                      struct iovec *kiov, bool writing);
 bool decompose_dir(const char* dir, char* ret_name, struct dir** par_dir);
 struct f_info *findfile(uint32_t fd);
 static uint32_t read4(struct intr_frame * f, int offset);
@@ -28,7 +35,9 @@ static struct lock filesys_lock;
 
 
 void syscall_init(void) {
-    lock_init(&filesys_lock);
+    lock_init_named(&filesys_lock, "filesys");
+    aio_init();
+    futex_init();
     intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
@@ -40,7 +49,9 @@ static void syscall_handler(struct intr_frame *f) {
     int status;
     const char *cmdline, *f_name;
     unsigned f_size, position, size;
-    uint32_t fd;
+    int iovcnt;
+    const struct iovec *iov;
+    uint32_t fd, fd_out;
     mapid_t mapping;
     struct supp_table *st;
     struct thread* t = thread_current();
@@ -49,6 +60,8 @@ static void syscall_handler(struct intr_frame *f) {
     uint32_t sys_no = read4(f, 0);
     
     void *buffer; 
+    void *aux;
+    void (*entry)(void);
     pid_t pid;
     
     /* The following is for page fault in syscall.
@@ -57,6 +70,10 @@ static void syscall_handler(struct intr_frame *f) {
     t->syscall = true;
     t->esp = f->esp;
 
+    /* Another thread of the process has called exit(), so follow it. */
+    if (t->proc->exiting)
+        exit(t->proc->exit_status);
+
     /* Note after each syscall is about to finish, we will
      * set the thread's syscall status back to false. */
     switch (sys_no) {
@@ -203,6 +220,137 @@ static void syscall_handler(struct intr_frame *f) {
             t->esp = NULL;
             break;
 
+        case SYS_PREAD:
+            fd = (uint32_t) read4(f, 4);
+            buffer = (void*) read4(f, 8);
+            size = (unsigned) read4(f, 12);
+            position = (unsigned) read4(f, 16);
+            f->eax = (uint32_t) _pread(fd, buffer, size, position);
+            t->syscall = false;
+            t->esp = NULL;
+            break;
+
+        case SYS_PWRITE:
+            fd = (uint32_t) read4(f, 4);
+            buffer = (void*) read4(f, 8);
+            size = (unsigned) read4(f, 12);
+            position = (unsigned) read4(f, 16);
+            f->eax = (uint32_t) _pwrite(fd, buffer, size, position);
+            t->syscall = false;
+            t->esp = NULL;
+            break;
+
+        case SYS_READV:
+            fd = (uint32_t) read4(f, 4);
+            iov = (const struct iovec*) read4(f, 8);
+            iovcnt = (int) read4(f, 12);
+            f->eax = (uint32_t) _readv(fd, iov, iovcnt);
+            t->syscall = false;
+            t->esp = NULL;
+            break;
+
+        case SYS_WRITEV:
+            fd = (uint32_t) read4(f, 4);
+            iov = (const struct iovec*) read4(f, 8);
+            iovcnt = (int) read4(f, 12);
+            f->eax = (uint32_t) _writev(fd, iov, iovcnt);
+            t->syscall = false;
+            t->esp = NULL;
+            break;
+
+        case SYS_COPY_FILE_RANGE:
+            fd = (uint32_t) read4(f, 4);
+            fd_out = (uint32_t) read4(f, 8);
+            size = (unsigned) read4(f, 12);
+            f->eax = (uint32_t) _copy_file_range(fd, fd_out, size);
+            t->syscall = false;
+            t->esp = NULL;
+            break;
+
+        case SYS_AIO_SETUP:
+            buffer = (void*) read4(f, 4);
+            f->eax = (uint32_t) aio_setup(buffer);
+            t->syscall = false;
+            t->esp = NULL;
+            break;
+
+        case SYS_AIO_ENTER:
+            size = (unsigned) read4(f, 4);
+            position = (unsigned) read4(f, 8);
+            f->eax = (uint32_t) aio_enter(size, position);
+            t->syscall = false;
+            t->esp = NULL;
+            break;
+
+        case SYS_FSYNC:
+            fd = (uint32_t) read4(f, 4);
+            f->eax = (uint32_t) _fsync(fd, false);
+            t->syscall = false;
+            t->esp = NULL;
+            break;
+
+        case SYS_FDATASYNC:
+            fd = (uint32_t) read4(f, 4);
+            f->eax = (uint32_t) _fsync(fd, true);
+            t->syscall = false;
+            t->esp = NULL;
+            break;
+
+        case SYS_BLKSTAT:
+            position = (unsigned) read4(f, 4);
+            buffer = (void*) read4(f, 8);
+            f->eax = (uint32_t) _blkstat(position, buffer);
+            t->syscall = false;
+            t->esp = NULL;
+            break;
+
+        case SYS_LOCKSTAT:
+            position = (unsigned) read4(f, 4);
+            buffer = (void*) read4(f, 8);
+            f->eax = (uint32_t) _lockstat(position, buffer);
+            t->syscall = false;
+            t->esp = NULL;
+            break;
+
+        case SYS_FUTEX_WAIT:
+            buffer = (void*) read4(f, 4);
+            size = (unsigned) read4(f, 8);
+            f->eax = (uint32_t) futex_wait(buffer, size);
+            t->syscall = false;
+            t->esp = NULL;
+            break;
+
+        case SYS_FUTEX_WAKE:
+            buffer = (void*) read4(f, 4);
+            size = (unsigned) read4(f, 8);
+            f->eax = (uint32_t) futex_wake(buffer, (int) size);
+            t->syscall = false;
+            t->esp = NULL;
+            break;
+
+        case SYS_THREAD_CREATE:
+            entry = (void (*)(void)) read4(f, 4);
+            buffer = (void*) read4(f, 8);
+            aux = (void*) read4(f, 12);
+            f->eax = (uint32_t) process_thread_create(entry, buffer, aux);
+            t->syscall = false;
+            t->esp = NULL;
+            break;
+
+        case SYS_THREAD_JOIN:
+            pid = (pid_t) read4(f, 4);
+            f->eax = (uint32_t) process_thread_join(pid);
+            t->syscall = false;
+            t->esp = NULL;
+            break;
+
+        case SYS_THREAD_EXIT:
+            status = (int) read4(f, 4);
+            process_thread_exit(status);
+            t->syscall = false;
+            t->esp = NULL;
+            break;
+
         default:
             exit(-1);
             t->syscall = false;
@@ -231,6 +379,9 @@ void exit(int status) {
     t = thread_current();
     t->trs->stat = status;
     t->parent = NULL;
+
+    /* Any thread's exit() ends the whole process with STATUS. */
+    process_set_exiting(status);
     thread_exit();
 }
 
@@ -367,7 +518,7 @@ int open(const char *f_name) {
         return -1;
     } else {
         /* Assign fd to the file / dir */
-        t = thread_current();
+        t = thread_current()->proc;
         if (t->f_count > 127){
             if (isdir){
                 dir_close(d_open);
@@ -425,12 +576,14 @@ int read(uint32_t fd, void *buffer, unsigned size) {
         exit(-1);
     }
     
+    supp_table_lock();
     for (addr_e = (uint8_t*) pg_round_down(buffer); 
          addr_e < (uint8_t*) buffer + size; addr_e += PGSIZE){
         st = find_supp_table(addr_e);
         if (st && !st->writable)
             exit(-1);
     }
+    supp_table_unlock();
     
     int read_size = 0;
     if (fd == STDIN_FILENO) {
@@ -537,7 +690,7 @@ void close(uint32_t fd) {
     
     list_remove(&f->elem);
     free(f);
-    struct thread* t = thread_current();
+    struct thread* t = thread_current()->proc;
     --(t->f_count);
     lock_release(&filesys_lock);
 
@@ -554,7 +707,7 @@ bool checkva(const void* va){
 
 struct f_info* findfile(uint32_t fd) {
     
-    struct thread *t = thread_current();
+    struct thread *t = thread_current()->proc;
     struct list* f_lst = &(t->f_lst);
     struct list_elem *e;
     
@@ -585,7 +738,7 @@ mapid_t mmap(uint32_t fd, void* addr){
     struct f_info* f;
     struct mmap_elem* me;
     struct supp_table* st;
-    struct thread* t = thread_current();
+    struct thread* t = thread_current()->proc;
     
     if (!checkva(addr))
         return MAP_FAIL;
@@ -606,10 +759,12 @@ mapid_t mmap(uint32_t fd, void* addr){
      * to-be-mapped user address does not overlap with any already allocated
      * pages. */
     f_size = filesize(fd);
+    supp_table_lock();
     for (addr_e = addr; addr_e < addr + f_size; addr_e += PGSIZE){
             if (find_supp_table(addr_e) != NULL){
                 /* If found a supplemental page entry of this page address,
                  * Then this is already alocated. Return MAP_FAIL. */
+                supp_table_unlock();
                 return MAP_FAIL;
             }   
     }
@@ -620,13 +775,18 @@ mapid_t mmap(uint32_t fd, void* addr){
     
     /* Allocated the new mmap struct */
     me = (struct mmap_elem*) malloc(sizeof(struct mmap_elem));
-    if (me == NULL)
+    if (me == NULL) {
+        supp_table_unlock();
         return MAP_FAIL;
+    }
     
     /* Reopen the file according to the file descriptor. */
     f = findfile(fd);
-    if (f->isdir)
+    if (f->isdir) {
+        free(me);
+        supp_table_unlock();
         return MAP_FAIL;
+    }
     lock_acquire(&filesys_lock);
     file = file_reopen(f->f);
     lock_release(&filesys_lock);
@@ -634,6 +794,7 @@ mapid_t mmap(uint32_t fd, void* addr){
     /* If the file is NULL, then free the struct and return MAP_FAIL. */
     if (file == NULL){
         free(me);
+        supp_table_unlock();
         return MAP_FAIL;
     }
     
@@ -675,6 +836,7 @@ mapid_t mmap(uint32_t fd, void* addr){
         ofs += page_read_bytes;
         
     }
+    supp_table_unlock();
     return mapid;
 }
 
@@ -687,8 +849,9 @@ void munmap(mapid_t mapping){
     struct supp_table* st;
     
     /* First find the mmap struct according to the given mapid. */
+    supp_table_lock();
     struct mmap_elem *me = find_mmap_elem(mapping);
-    struct thread* t = thread_current();
+    struct thread* t = thread_current()->proc;
     
     /* Get the file length. And set write_bytes as file length.*/
     f_size = file_length(me->file);
@@ -730,6 +893,7 @@ void munmap(mapid_t mapping){
     list_remove(&(me->elem));
     /* Free the memory of this struct. */
     free(me);
+    supp_table_unlock();
 }
 
 /*! Given a mapid, look for and return the corresponding mapid struct
@@ -737,7 +901,7 @@ void munmap(mapid_t mapping){
 struct mmap_elem* find_mmap_elem(mapid_t mapid){
     
     struct list_elem *e;
-    struct thread* t = thread_current();
+    struct thread* t = thread_current()->proc;
     struct list* m_lst = &(t->mmap_lst);
     struct mmap_elem* me;
     
@@ -1023,3 +1187,267 @@ bool _readdir(uint32_t fd, char* name){
     return dir_readdir(f->d, name);
 }
 
+/*! Checks that the user buffer of SIZE bytes at BUFFER lies in user
+ * memory, exiting the process otherwise.  If WRITING is set, the kernel is
+ * about to store into the buffer, so none of its pages may be read-only. */
+static void checkbuf(const void *buffer, unsigned size, bool writing) {
+    uint8_t* addr_e;
+    struct supp_table* st;
+
+    if (!checkva(buffer) || !checkva((const uint8_t*) buffer + size))
+        exit(-1);
+
+    if (!writing)
+        return;
+
+    supp_table_lock();
+    for (addr_e = (uint8_t*) pg_round_down(buffer);
+         addr_e < (const uint8_t*) buffer + size; addr_e += PGSIZE){
+        st = find_supp_table(addr_e);
+        if (st && !st->writable)
+            exit(-1);
+    }
+    supp_table_unlock();
+}
+
+/*! Copies IOVCNT iovec entries from user memory at IOV into KIOV and
+ * validates every buffer they describe, so that the transfer itself never
+ * has to back out half-way.  Returns the total byte count of the request,
+ * or -1 if IOVCNT is out of range or the total would not fit in an int. */
+static int copy_iovec(const struct iovec *iov, int iovcnt,
+                      struct iovec *kiov, bool writing) {
+    int i;
+    unsigned total = 0;
+
+    if (iovcnt < 0 || iovcnt > IOV_MAX)
+        return -1;
+    if (iovcnt == 0)
+        return 0;
+
+    checkbuf(iov, iovcnt * sizeof *iov, false);
+    memcpy(kiov, iov, iovcnt * sizeof *iov);
+
+    for (i = 0; i < iovcnt; i++) {
+        if (kiov[i].iov_len > (unsigned) INT_MAX - total)
+            return -1;
+        total += kiov[i].iov_len;
+        if (kiov[i].iov_len > 0)
+            checkbuf(kiov[i].iov_base, kiov[i].iov_len, writing);
+    }
+    return (int) total;
+}
+
+/*! Reads up to SIZE bytes from fd at byte OFFSET into BUFFER, without
+ * using or moving the descriptor's current position.  Returns the number of
+ * bytes read, which is short at end of file, or -1 if fd is a console
+ * descriptor or OFFSET does not fit in an off_t. */
+int _pread(uint32_t fd, void *buffer, unsigned size, unsigned offset) {
+    off_t length;
+
+    checkbuf(buffer, size, true);
+
+    /* The console has no notion of an offset. */
+    if (fd == STDIN_FILENO || fd == STDOUT_FILENO)
+        return -1;
+
+    struct f_info* f = findfile(fd);
+    if (f->isdir)
+        exit(-1);
+
+    /* Offsets must fit in an off_t, and the read stops at end of file. */
+    if (offset > INT_MAX)
+        return -1;
+    length = file_length(f->f);
+    if ((off_t) offset >= length)
+        return 0;
+    if (size > (unsigned) (length - (off_t) offset))
+        size = length - (off_t) offset;
+
+    return (int) file_read_at(f->f, buffer, (off_t) size, (off_t) offset);
+}
+
+/*! Writes SIZE bytes from BUFFER to fd at byte OFFSET, without using or
+ * moving the descriptor's current position.  Returns the number of bytes
+ * written, or -1 if fd is a console descriptor or the write would end
+ * past the largest off_t. */
+int _pwrite(uint32_t fd, const void *buffer, unsigned size,
+            unsigned offset) {
+    checkbuf(buffer, size, false);
+
+    if (fd == STDIN_FILENO || fd == STDOUT_FILENO)
+        return -1;
+
+    struct f_info* f = findfile(fd);
+    if (f->isdir)
+        exit(-1);
+
+    /* The end of the write must fit in an off_t. */
+    if (offset > INT_MAX || size > INT_MAX - offset)
+        return -1;
+
+    return (int) file_write_at(f->f, buffer, (off_t) size, (off_t) offset);
+}
+
+/*! Reads from fd into the IOVCNT buffers described by IOV, filling each
+ * one completely before moving on to the next, and stops at end of file.
+ * Returns the total number of bytes read, or -1 on a bad iovec array. */
+int _readv(uint32_t fd, const struct iovec *iov, int iovcnt) {
+    struct iovec kiov[IOV_MAX];
+    struct f_info* f = NULL;
+    int read_size = 0;
+    int i;
+
+    if (copy_iovec(iov, iovcnt, kiov, true) < 0)
+        return -1;
+
+    if (fd != STDIN_FILENO) {
+        f = findfile(fd);
+        if (f->isdir)
+            exit(-1);
+    }
+
+    for (i = 0; i < iovcnt; i++) {
+        uint8_t *buffer = kiov[i].iov_base;
+        unsigned len = kiov[i].iov_len;
+        off_t n, left;
+
+        if (f == NULL) {
+            /* If std-in, then read using input_getc() */
+            unsigned j;
+            for (j = 0; j < len; j++)
+                buffer[j] = input_getc();
+            read_size += len;
+            continue;
+        }
+
+        left = file_length(f->f) - f->pos;
+        if (left < 0)
+            left = 0;
+        if (len > (unsigned) left)
+            len = left;
+        n = file_read_at(f->f, buffer, (off_t) len, f->pos);
+        f->pos += n;
+        read_size += n;
+
+        /* Stop at end of file. */
+        if ((unsigned) n < len)
+            break;
+    }
+    return read_size;
+}
+
+/*! Writes the IOVCNT buffers described by IOV to fd, in order.  Returns
+ * the total number of bytes written, or -1 on a bad iovec array. */
+int _writev(uint32_t fd, const struct iovec *iov, int iovcnt) {
+    struct iovec kiov[IOV_MAX];
+    struct f_info* f = NULL;
+    int write_size = 0;
+    int i;
+
+    if (copy_iovec(iov, iovcnt, kiov, false) < 0)
+        return -1;
+
+    if (fd != STDOUT_FILENO) {
+        f = findfile(fd);
+        if (f->isdir)
+            exit(-1);
+    }
+
+    for (i = 0; i < iovcnt; i++) {
+        const uint8_t *buffer = kiov[i].iov_base;
+        unsigned len = kiov[i].iov_len;
+        off_t n;
+
+        if (f == NULL) {
+            /* If std-out, then write using putbuf() */
+            putbuf((const char *) buffer, len);
+            write_size += len;
+            continue;
+        }
+
+        n = file_write_at(f->f, buffer, (off_t) len, f->pos);
+        f->pos += n;
+        write_size += n;
+
+        /* A short write means the file could not grow any further. */
+        if ((unsigned) n < len)
+            break;
+    }
+    return write_size;
+}
+
+/*! Copies up to SIZE bytes from fd_in to fd_out entirely inside the
+ * kernel, starting at each descriptor's current position and advancing
+ * both by the amount copied.  Returns the number of bytes copied, 0 at end
+ * of fd_in, or -1 if either descriptor is the console or a directory, if
+ * they are the same descriptor, or if they refer to the same file and the
+ * two ranges overlap. */
+int _copy_file_range(uint32_t fd_in, uint32_t fd_out, unsigned size) {
+    struct f_info *in, *out;
+    off_t copied;
+
+    if (fd_in == STDIN_FILENO || fd_in == STDOUT_FILENO ||
+        fd_out == STDIN_FILENO || fd_out == STDOUT_FILENO)
+        return -1;
+
+    in = findfile(fd_in);
+    out = findfile(fd_out);
+    if (in->isdir || out->isdir || in == out)
+        return -1;
+
+    /* The copy runs forward a chunk at a time, so an overlapping range
+       would read bytes that it has already overwritten. */
+    if (file_get_inode(in->f) == file_get_inode(out->f) &&
+        (int64_t) in->pos < (int64_t) out->pos + size &&
+        (int64_t) out->pos < (int64_t) in->pos + size)
+        return -1;
+
+    copied = file_copy_at(out->f, out->pos, in->f, in->pos, (off_t) size);
+    in->pos += copied;
+    out->pos += copied;
+    return (int) copied;
+}
+
+/*! Writes the cached data of the file or directory open as fd back to
+ * disk, and its on-disk inode too unless DATA_ONLY is set (fdatasync).
+ * Only that inode's dirty blocks are written.  Returns false for the
+ * console descriptors. */
+bool _fsync(uint32_t fd, bool data_only) {
+    struct f_info *f;
+
+    if (fd == STDIN_FILENO || fd == STDOUT_FILENO)
+        return false;
+
+    f = findfile(fd);
+    if (f->isdir)
+        inode_sync(dir_get_inode(f->d), data_only);
+    else
+        file_sync(f->f, data_only);
+    return true;
+}
+
+/*! Copies the I/O statistics of the block device at position INDEX in
+ * kernel probe order to STATS.  Returns false if there is no such
+ * device, so that a process can walk them all by counting up from 0. */
+bool _blkstat(unsigned index, struct blkstat *stats) {
+    struct blkstat kstats;
+
+    checkbuf(stats, sizeof *stats, true);
+    if (!block_get_stats(index, &kstats))
+        return false;
+    memcpy(stats, &kstats, sizeof kstats);
+    return true;
+}
+
+/*! Copies the contention statistics of the lock name registered at
+ * position INDEX to STATS.  Returns false if there is no such name, which
+ * is always the case unless the kernel was started with -lockstat. */
+bool _lockstat(unsigned index, struct lockstat *stats) {
+    struct lockstat kstats;
+
+    checkbuf(stats, sizeof *stats, true);
+    if (!lockstat_get(index, &kstats))
+        return false;
+    memcpy(stats, &kstats, sizeof kstats);
+    return true;
+}
@@ -1,6 +1,8 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <blkstat.h>
+#include <lockstat.h>
 #include <stdio.h>
 #include <string.h>
 #include <syscall-nr.h>
@@ -14,10 +16,21 @@
 #include "filesys/file.h"
 #include "devices/input.h"
 #include "userprog/pagedir.h"
+#include "userprog/aio.h"
 
 typedef int mapid_t;
 #define MAP_FAIL ((mapid_t) -1)
 
+/*! Maximum number of buffers accepted by readv() and writev(). */
+#define IOV_MAX 64
+
+/*! One buffer of a readv() or writev() request, as laid out in user
+    memory. */
+struct iovec {
+    void *iov_base;             /*!< Start of the buffer. */
+    unsigned iov_len;           /*!< Length of the buffer in bytes. */
+};
+
 struct mmap_elem {
     mapid_t mapid;              /*! map id */
     struct list s_table;        /*! supp table of pages associated with 
@@ -44,6 +57,8 @@ mapid_t mmap(uint32_t fd, void* addr);
 void munmap(mapid_t mapping);
 
 struct mmap_elem* find_mmap_elem(mapid_t mapid);
+bool checkva(const void* va);
+struct f_info *findfile(uint32_t fd);
 
 bool _chdir(const char* dir);
 bool _mkdir(const char* dir);
@@ -51,5 +66,14 @@ bool _readdir(uint32_t fd, char* name);
 bool _isdir(uint32_t fd);
 int _inumber(uint32_t fd);
 
+int _pread(uint32_t fd, void *buffer, unsigned size, unsigned offset);
+int _pwrite(uint32_t fd, const void *buffer, unsigned size, unsigned offset);
+int _readv(uint32_t fd, const struct iovec *iov, int iovcnt);
+int _writev(uint32_t fd, const struct iovec *iov, int iovcnt);
+int _copy_file_range(uint32_t fd_in, uint32_t fd_out, unsigned size);
+bool _fsync(uint32_t fd, bool data_only);
+bool _blkstat(unsigned index, struct blkstat *stats);
+bool _lockstat(unsigned index, struct lockstat *stats);
+
 #endif /* userprog/syscall.h */
 
@@ -0,0 +1,276 @@
+/* Summarizes a block I/O trace written by a Pintos kernel started with
+   -blktrace.  The trace is found by scanning IMAGE, which may be the
+   scratch partition or a whole disk image containing it, for the trace
+   header at a sector boundary.
+
+   For each device it reports request counts, sequential runs, seek
+   distances and the reuse distance of sectors, that is, the number of
+   distinct other sectors touched between two touches of the same sector.
+   A sector is a hit in an LRU cache of C sectors exactly when its reuse
+   distance is less than C, so the report also gives the hit rate of LRU
+   caches of several sizes. */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../lib/blktrace.h"
+
+#define SECTOR_SIZE 512
+
+/* Reuse distances are bucketed by powers of 2 up to this many. */
+#define DIST_BUCKETS 20
+
+static const char *type_names[] =
+  { "kernel", "filesys", "scratch", "swap", "raw", "foreign" };
+
+/* Statistics for one device. */
+struct dev_stats
+  {
+    unsigned long requests[2];          /* By direction: read, write. */
+    unsigned long sectors[2];
+    unsigned long sync;                 /* Requests the submitter waited on. */
+    unsigned long runs;                 /* Sequential runs. */
+    unsigned long long seek_total;      /* Sum of seek distances. */
+    unsigned long seek_max;
+    uint32_t next_sector;               /* Sector after last request. */
+    bool started;
+
+    uint32_t *lru;                      /* Sectors, most recent first. */
+    size_t lru_cnt;
+    unsigned long cold;                 /* First touches. */
+    unsigned long touches;
+    unsigned long dist[DIST_BUCKETS + 1];   /* Log2 reuse distances. */
+  };
+
+static void
+usage (const char *program_name)
+{
+  fprintf (stderr,
+           "blktrace: summarizes a Pintos block I/O trace\n"
+           "usage: %s [-l] IMAGE\n"
+           "  -l  also list every request in order\n",
+           program_name);
+  exit (EXIT_FAILURE);
+}
+
+/* Reads the whole of FILE_NAME into memory and stores its size in
+   *SIZE. */
+static unsigned char *
+read_file (const char *file_name, size_t *size)
+{
+  unsigned char *data = NULL;
+  size_t capacity = 0;
+  FILE *f = fopen (file_name, "rb");
+
+  if (f == NULL)
+    {
+      fprintf (stderr, "%s: %s\n", file_name, strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+  *size = 0;
+  for (;;)
+    {
+      size_t n;
+      if (*size == capacity)
+        {
+          capacity = capacity ? capacity * 2 : 1 << 20;
+          data = realloc (data, capacity);
+          if (data == NULL)
+            {
+              fprintf (stderr, "out of memory\n");
+              exit (EXIT_FAILURE);
+            }
+        }
+      n = fread (data + *size, 1, capacity - *size, f);
+      if (n == 0)
+        break;
+      *size += n;
+    }
+  fclose (f);
+  return data;
+}
+
+/* Records a touch of SECTOR in S's LRU stack. */
+static void
+touch (struct dev_stats *s, uint32_t sector)
+{
+  size_t i;
+
+  s->touches++;
+  for (i = 0; i < s->lru_cnt; i++)
+    if (s->lru[i] == sector)
+      break;
+
+  if (i == s->lru_cnt)
+    {
+      s->cold++;
+      s->lru = realloc (s->lru, (s->lru_cnt + 1) * sizeof *s->lru);
+      if (s->lru == NULL)
+        {
+          fprintf (stderr, "out of memory\n");
+          exit (EXIT_FAILURE);
+        }
+      s->lru_cnt++;
+    }
+  else
+    {
+      int bucket = 0;
+      size_t d = i;
+      while (d > 1 && bucket < DIST_BUCKETS)
+        {
+          d >>= 1;
+          bucket++;
+        }
+      s->dist[bucket]++;
+    }
+
+  memmove (s->lru + 1, s->lru, i * sizeof *s->lru);
+  s->lru[0] = sector;
+}
+
+/* Returns the number of touches of S that hit in an LRU cache of CAPACITY
+   sectors, where CAPACITY is a power of 2. */
+static unsigned long
+lru_hits (const struct dev_stats *s, size_t capacity)
+{
+  unsigned long hits = 0;
+  int bucket;
+
+  /* Bucket B holds distances from 2**B up to 2**(B+1), except bucket 0,
+     which also holds 0. */
+  for (bucket = 0; bucket <= DIST_BUCKETS; bucket++)
+    if ((size_t) 2 << bucket <= capacity)
+      hits += s->dist[bucket];
+  return hits;
+}
+
+static void
+print_stats (const struct blktrace_dev *dev, const struct dev_stats *s)
+{
+  unsigned long total = s->requests[0] + s->requests[1];
+  size_t capacity;
+  int bucket;
+
+  if (total == 0)
+    return;
+
+  printf ("%s (%s, %u sectors):\n", dev->name,
+          dev->type < sizeof type_names / sizeof *type_names
+          ? type_names[dev->type] : "?", dev->size);
+  printf ("  %lu reads (%lu sectors), %lu writes (%lu sectors), "
+          "%lu%% synchronous\n",
+          s->requests[0], s->sectors[0], s->requests[1], s->sectors[1],
+          s->sync * 100 / total);
+  printf ("  %lu sequential runs, %.1f requests per run\n",
+          s->runs, (double) total / s->runs);
+  printf ("  seek distance: avg %.1f sectors, max %lu sectors\n",
+          (double) s->seek_total / total, s->seek_max);
+  printf ("  %lu sector touches, %lu distinct sectors\n",
+          s->touches, s->cold);
+
+  printf ("  reuse distance:");
+  for (bucket = 0; bucket <= DIST_BUCKETS; bucket++)
+    if (s->dist[bucket] != 0)
+      printf (" <%lu:%lu", 2ul << bucket, s->dist[bucket]);
+  printf ("\n");
+
+  printf ("  LRU hit rate:");
+  for (capacity = 16; capacity <= 4096; capacity *= 4)
+    printf (" %zu:%.1f%%", capacity,
+            100.0 * lru_hits (s, capacity) / s->touches);
+  printf ("\n");
+}
+
+int
+main (int argc, char *argv[])
+{
+  struct dev_stats stats[BLKTRACE_MAX_DEVS];
+  struct blktrace_header h;
+  const unsigned char *entries;
+  unsigned char *image;
+  bool list = false;
+  size_t size, ofs;
+  uint32_t i;
+  int opt;
+
+  while ((opt = getopt (argc, argv, "l")) != -1)
+    if (opt == 'l')
+      list = true;
+    else
+      usage (argv[0]);
+  if (optind != argc - 1)
+    usage (argv[0]);
+
+  image = read_file (argv[optind], &size);
+  for (ofs = 0; ofs + SECTOR_SIZE <= size; ofs += SECTOR_SIZE)
+    if (!memcmp (image + ofs, BLKTRACE_MAGIC, 8))
+      break;
+  if (ofs + SECTOR_SIZE > size)
+    {
+      fprintf (stderr, "%s: no trace found\n", argv[optind]);
+      return EXIT_FAILURE;
+    }
+
+  memcpy (&h, image + ofs, sizeof h);
+  if (h.version != BLKTRACE_VERSION || h.dev_cnt > BLKTRACE_MAX_DEVS)
+    {
+      fprintf (stderr, "%s: unsupported trace version %u\n",
+               argv[optind], h.version);
+      return EXIT_FAILURE;
+    }
+  entries = image + ofs + SECTOR_SIZE;
+  if (h.entry_cnt > (size - ofs - SECTOR_SIZE) / sizeof (struct blktrace_entry))
+    {
+      fprintf (stderr, "%s: trace truncated\n", argv[optind]);
+      return EXIT_FAILURE;
+    }
+
+  printf ("%u requests traced, %u earlier ones lost\n", h.entry_cnt, h.lost);
+  memset (stats, 0, sizeof stats);
+  for (i = 0; i < h.entry_cnt; i++)
+    {
+      struct blktrace_entry e;
+      struct dev_stats *s;
+      bool write;
+      uint32_t j;
+
+      memcpy (&e, entries + i * sizeof e, sizeof e);
+      if (e.dev >= h.dev_cnt)
+        continue;
+      s = &stats[e.dev];
+      write = (e.flags & BLKTRACE_WRITE) != 0;
+
+      if (list)
+        printf ("%10u us %-8s %c%c %10u +%u\n", e.time_us,
+                h.devs[e.dev].name, write ? 'W' : 'R',
+                e.flags & BLKTRACE_SYNC ? 'S' : 'A', e.sector, e.cnt);
+
+      s->requests[write]++;
+      s->sectors[write] += e.cnt;
+      if (e.flags & BLKTRACE_SYNC)
+        s->sync++;
+      if (!s->started || e.sector != s->next_sector)
+        {
+          unsigned long seek = 0;
+          if (s->started)
+            seek = (e.sector > s->next_sector ? e.sector - s->next_sector
+                    : s->next_sector - e.sector);
+          s->seek_total += seek;
+          if (seek > s->seek_max)
+            s->seek_max = seek;
+          s->runs++;
+        }
+      s->next_sector = e.sector + e.cnt;
+      s->started = true;
+
+      for (j = 0; j < e.cnt; j++)
+        touch (s, e.sector + j);
+    }
+
+  for (i = 0; i < h.dev_cnt; i++)
+    print_stats (&h.devs[i], &stats[i]);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,347 @@
+/* Summarizes a scheduler trace written by a Pintos kernel started with
+   -schedtrace.  The trace is found by scanning IMAGE, which may be the
+   scratch partition or a whole disk image containing it, for the trace
+   header at a sector boundary.
+
+   It reports why threads gave up the CPU, the wakeup latency of blocked
+   threads, that is, the time from thread_unblock() until the thread next
+   runs, the same for threads that were put back on the run queue by a
+   yield or a preemption, the length of the run queue at each switch, and
+   the CPU time and switch counts of each thread.  The idle thread is left
+   out of latencies and runtimes. */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../lib/schedtrace.h"
+
+#define SECTOR_SIZE 512
+
+/* Latencies are bucketed by powers of 2 microseconds up to this many. */
+#define LAT_BUCKETS 24
+
+/* Run-queue lengths are counted individually up to this many. */
+#define QUEUE_MAX 32
+
+static const char *reason_names[] = { "yield", "block", "preempt", "exit" };
+
+/* A set of latencies. */
+struct latency
+  {
+    double *us;                         /* Samples, in microseconds. */
+    size_t cnt;
+    unsigned long hist[LAT_BUCKETS + 1];        /* Log2 buckets. */
+  };
+
+/* Statistics for one thread. */
+struct thread_stats
+  {
+    int tid;
+    double run_us;                      /* Time on the CPU. */
+    unsigned long runs;                 /* Times switched to. */
+    unsigned long reasons[SCHEDTRACE_EXIT + 1];   /* Switches away. */
+    bool waiting;                       /* Ready but not yet running? */
+    bool woken;                         /* ...because of a wakeup? */
+    uint64_t ready_tsc;                 /* When it became ready. */
+  };
+
+static struct thread_stats *threads;
+static size_t thread_cnt;
+
+static void
+usage (const char *program_name)
+{
+  fprintf (stderr,
+           "schedtrace: summarizes a Pintos scheduler trace\n"
+           "usage: %s [-l] IMAGE\n"
+           "  -l  also list every event in order\n",
+           program_name);
+  exit (EXIT_FAILURE);
+}
+
+static void *
+xrealloc (void *p, size_t size)
+{
+  p = realloc (p, size);
+  if (p == NULL)
+    {
+      fprintf (stderr, "out of memory\n");
+      exit (EXIT_FAILURE);
+    }
+  return p;
+}
+
+/* Reads the whole of FILE_NAME into memory and stores its size in
+   *SIZE. */
+static unsigned char *
+read_file (const char *file_name, size_t *size)
+{
+  unsigned char *data = NULL;
+  size_t capacity = 0;
+  FILE *f = fopen (file_name, "rb");
+
+  if (f == NULL)
+    {
+      fprintf (stderr, "%s: %s\n", file_name, strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+  *size = 0;
+  for (;;)
+    {
+      size_t n;
+      if (*size == capacity)
+        {
+          capacity = capacity ? capacity * 2 : 1 << 20;
+          data = xrealloc (data, capacity);
+        }
+      n = fread (data + *size, 1, capacity - *size, f);
+      if (n == 0)
+        break;
+      *size += n;
+    }
+  fclose (f);
+  return data;
+}
+
+/* Returns the statistics for TID, creating them if needed. */
+static struct thread_stats *
+lookup (int tid)
+{
+  size_t i;
+
+  for (i = 0; i < thread_cnt; i++)
+    if (threads[i].tid == tid)
+      return &threads[i];
+
+  threads = xrealloc (threads, (thread_cnt + 1) * sizeof *threads);
+  memset (&threads[thread_cnt], 0, sizeof *threads);
+  threads[thread_cnt].tid = tid;
+  return &threads[thread_cnt++];
+}
+
+/* Adds a sample of US microseconds to L. */
+static void
+add_latency (struct latency *l, double us)
+{
+  int bucket = 0;
+  double d = us;
+
+  l->us = xrealloc (l->us, (l->cnt + 1) * sizeof *l->us);
+  l->us[l->cnt++] = us;
+  while (d >= 2 && bucket < LAT_BUCKETS)
+    {
+      d /= 2;
+      bucket++;
+    }
+  l->hist[bucket]++;
+}
+
+static int
+compare_doubles (const void *a_, const void *b_)
+{
+  const double *a = a_;
+  const double *b = b_;
+  return *a < *b ? -1 : *a > *b;
+}
+
+static int
+compare_runtime (const void *a_, const void *b_)
+{
+  const struct thread_stats *a = a_;
+  const struct thread_stats *b = b_;
+  return a->run_us > b->run_us ? -1 : a->run_us < b->run_us;
+}
+
+static void
+print_latency (const char *title, struct latency *l)
+{
+  double total = 0;
+  size_t i;
+  int bucket;
+
+  if (l->cnt == 0)
+    return;
+
+  qsort (l->us, l->cnt, sizeof *l->us, compare_doubles);
+  for (i = 0; i < l->cnt; i++)
+    total += l->us[i];
+  printf ("%s: %zu samples\n", title, l->cnt);
+  printf ("  avg %.1f us, p50 %.1f us, p90 %.1f us, p99 %.1f us, "
+          "max %.1f us\n",
+          total / l->cnt, l->us[l->cnt / 2], l->us[l->cnt * 9 / 10],
+          l->us[l->cnt * 99 / 100], l->us[l->cnt - 1]);
+  printf ("  histogram:");
+  for (bucket = 0; bucket <= LAT_BUCKETS; bucket++)
+    if (l->hist[bucket] != 0)
+      printf (" <%lu:%lu", 2ul << bucket, l->hist[bucket]);
+  printf ("\n");
+}
+
+int
+main (int argc, char *argv[])
+{
+  struct latency wakeup, requeue;
+  unsigned long reasons[SCHEDTRACE_EXIT + 1];
+  unsigned long queue[QUEUE_MAX + 1];
+  unsigned long long queue_total = 0;
+  unsigned long switches = 0;
+  struct schedtrace_header h;
+  const unsigned char *entries;
+  unsigned char *image;
+  bool list = false;
+  double us_per_cycle;
+  uint64_t first_tsc = 0, last_tsc = 0;
+  int running = -1;
+  size_t size, ofs;
+  uint32_t i;
+  int opt;
+
+  while ((opt = getopt (argc, argv, "l")) != -1)
+    if (opt == 'l')
+      list = true;
+    else
+      usage (argv[0]);
+  if (optind != argc - 1)
+    usage (argv[0]);
+
+  image = read_file (argv[optind], &size);
+  for (ofs = 0; ofs + SECTOR_SIZE <= size; ofs += SECTOR_SIZE)
+    if (!memcmp (image + ofs, SCHEDTRACE_MAGIC, 8))
+      break;
+  if (ofs + SECTOR_SIZE > size)
+    {
+      fprintf (stderr, "%s: no trace found\n", argv[optind]);
+      return EXIT_FAILURE;
+    }
+
+  memcpy (&h, image + ofs, sizeof h);
+  if (h.version != SCHEDTRACE_VERSION || h.cycles_per_sec == 0)
+    {
+      fprintf (stderr, "%s: unsupported trace version %u\n",
+               argv[optind], h.version);
+      return EXIT_FAILURE;
+    }
+  entries = image + ofs + SECTOR_SIZE;
+  if ((h.entry_cnt + SCHEDTRACE_PER_SECTOR - 1) / SCHEDTRACE_PER_SECTOR
+      > (size - ofs - SECTOR_SIZE) / SECTOR_SIZE)
+    {
+      fprintf (stderr, "%s: trace truncated\n", argv[optind]);
+      return EXIT_FAILURE;
+    }
+  us_per_cycle = 1e6 / h.cycles_per_sec;
+
+  printf ("%u events traced on %u CPU(s), %u earlier ones lost\n",
+          h.entry_cnt, h.cpu_cnt, h.lost);
+  memset (&wakeup, 0, sizeof wakeup);
+  memset (&requeue, 0, sizeof requeue);
+  memset (reasons, 0, sizeof reasons);
+  memset (queue, 0, sizeof queue);
+  for (i = 0; i < h.entry_cnt; i++)
+    {
+      struct schedtrace_entry e;
+      struct thread_stats *prev, *next;
+
+      memcpy (&e, entries + i / SCHEDTRACE_PER_SECTOR * SECTOR_SIZE
+              + i % SCHEDTRACE_PER_SECTOR * sizeof e, sizeof e);
+      if (i == 0)
+        first_tsc = e.tsc;
+      last_tsc = e.tsc;
+
+      if (e.type == SCHEDTRACE_WAKEUP)
+        {
+          if (list)
+            printf ("%12.1f us cpu%u wakeup  %5d (pri %2u) ready %u\n",
+                    (e.tsc - first_tsc) * us_per_cycle, e.cpu, e.tid,
+                    e.priority, e.ready_cnt);
+          if (e.tid == h.idle_tid)
+            continue;
+          next = lookup (e.tid);
+          next->waiting = true;
+          next->woken = true;
+          next->ready_tsc = e.tsc;
+          continue;
+        }
+      if (e.type != SCHEDTRACE_SWITCH || e.reason > SCHEDTRACE_EXIT)
+        continue;
+
+      if (list)
+        printf ("%12.1f us cpu%u %-7s %5d (pri %2u) -> %5d (pri %2u) "
+                "ready %u\n",
+                (e.tsc - first_tsc) * us_per_cycle, e.cpu,
+                reason_names[e.reason], e.tid, e.priority,
+                e.next_tid, e.next_priority, e.ready_cnt);
+
+      switches++;
+      reasons[e.reason]++;
+      queue[e.ready_cnt < QUEUE_MAX ? e.ready_cnt : QUEUE_MAX]++;
+      queue_total += e.ready_cnt;
+
+      /* The thread switched away from. */
+      if (e.tid != h.idle_tid)
+        {
+          prev = lookup (e.tid);
+          prev->reasons[e.reason]++;
+          if (running == e.tid)
+            prev->run_us += (e.tsc - prev->ready_tsc) * us_per_cycle;
+          if (e.reason == SCHEDTRACE_YIELD || e.reason == SCHEDTRACE_PREEMPT)
+            {
+              prev->waiting = true;
+              prev->woken = false;
+              prev->ready_tsc = e.tsc;
+            }
+        }
+
+      /* The thread switched to.  Its READY_TSC becomes the time it
+         started running. */
+      running = e.next_tid;
+      if (e.next_tid != h.idle_tid)
+        {
+          next = lookup (e.next_tid);
+          next->runs++;
+          if (next->waiting)
+            add_latency (next->woken ? &wakeup : &requeue,
+                         (e.tsc - next->ready_tsc) * us_per_cycle);
+          next->waiting = false;
+          next->ready_tsc = e.tsc;
+        }
+    }
+
+  printf ("%.1f ms traced, %lu switches:", (last_tsc - first_tsc)
+          * us_per_cycle / 1000, switches);
+  for (i = 0; i <= SCHEDTRACE_EXIT; i++)
+    printf (" %lu %s", reasons[i], reason_names[i]);
+  printf ("\n");
+
+  print_latency ("wakeup latency", &wakeup);
+  print_latency ("yield/preempt requeue latency", &requeue);
+
+  if (switches != 0)
+    {
+      printf ("run queue length at switch: avg %.2f\n ",
+              (double) queue_total / switches);
+      for (i = 0; i <= QUEUE_MAX; i++)
+        if (queue[i] != 0)
+          printf (" %s%u:%lu", i == QUEUE_MAX ? ">=" : "", i, queue[i]);
+      printf ("\n");
+    }
+
+  qsort (threads, thread_cnt, sizeof *threads, compare_runtime);
+  printf ("%5s %12s %8s", "tid", "runtime us", "runs");
+  for (i = 0; i <= SCHEDTRACE_EXIT; i++)
+    printf (" %8s", reason_names[i]);
+  printf ("\n");
+  for (i = 0; i < thread_cnt; i++)
+    {
+      const struct thread_stats *t = &threads[i];
+      int r;
+
+      printf ("%5d %12.1f %8lu", t->tid, t->run_us, t->runs);
+      for (r = 0; r <= SCHEDTRACE_EXIT; r++)
+        printf (" %8lu", t->reasons[r]);
+      printf ("\n");
+    }
+  return EXIT_SUCCESS;
+}
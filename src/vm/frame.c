@@ -17,7 +17,7 @@ void * frame_evict(enum palloc_flags flag);
 /*! Initialize the frame table global variable */
 void frame_table_init(void) {
     list_init(&f_table.table);
-    lock_init(&f_table.lock);
+    lock_init_named(&f_table.lock, "frame table");
     f_table.hand = 0;
 }
 
@@ -39,7 +39,7 @@ struct frame_table_entry *obtain_frame(enum palloc_flags flag,
     if (!newframe)
         PANIC("malloc failure\n");
     newframe->physical_addr = page;
-    newframe->owner = thread_current();
+    newframe->owner = thread_current()->proc;
     newframe->spt = pte;
     if (f_table.lock.holder != thread_current())
         lock_acquire(&f_table.lock);
@@ -72,8 +72,8 @@ void * frame_evict(enum palloc_flags flag) {
     while (true) {
         cf = list_entry(ce, struct frame_table_entry, elem);
         ct = cf->owner;
-        if (!cf->spt->pinned) {
-            /* If pinned, skip this frame */
+        if (!cf->spt->pinned && cf->spt->io_pins == 0) {
+            /* If pinned or under asynchronous I/O, skip this frame */
             if (pagedir_is_accessed(ct->pagedir, cf->spt->upage))
                 /* If accessed, clear accessed bit */
                 pagedir_set_accessed(ct->pagedir, cf->spt->upage, false);
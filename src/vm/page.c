@@ -21,6 +21,18 @@ void supp_table_init(struct hash* s_table) {
     hash_init(s_table, spte_hash_func, spte_less_func, NULL);
 }
 
+/*! Locks the supplemental page table of the current process, which all of
+    its threads share.  Must be held to look up, add or remove entries once
+    the process may have more than one thread. */
+void supp_table_lock(void) {
+    lock_acquire(&thread_current()->proc->s_table_lock);
+}
+
+/*! Unlocks the table locked by supp_table_lock(). */
+void supp_table_unlock(void) {
+    lock_release(&thread_current()->proc->s_table_lock);
+}
+
 /*! Given a virtual address, look for the corresponding
     supplemental page entry in the thread. Return
     NULL if not found. */
@@ -33,7 +45,7 @@ struct supp_table * find_supp_table(void *virtual_addr){
     st.upage = pg_round_down(virtual_addr);
     
     /* Look for the page by using hash_find */
-    e = hash_find(&t->s_table, &st.elem);
+    e = hash_find(&t->proc->s_table, &st.elem);
 
     return e != NULL ? hash_entry(e, struct supp_table, elem) : NULL;
 }
@@ -64,9 +76,10 @@ struct supp_table * create_supp_table(struct file *file, off_t ofs,
     st->writable = writable;
     st->fr = NULL;
     st->pinned = false;
+    st->io_pins = 0;
    
     /* Insert the new entry to the s_table of the process */
-    hash_insert(&(thread_current()->s_table), &st->elem);
+    hash_insert(&(thread_current()->proc->s_table), &st->elem);
    
     return st;
 }
@@ -89,9 +102,10 @@ struct supp_table * create_stack_supp_table(void* virtual_addr){
     st->pinned = true;
     if (intr_context())
         st->pinned = false;
+    st->io_pins = 0;
     
     /* Insert the new entry to the s_table of the process */
-    hash_insert(&(thread_current()->s_table), &st->elem);
+    hash_insert(&(thread_current()->proc->s_table), &st->elem);
     
     return st;
 }
@@ -120,14 +134,42 @@ struct supp_table * create_mmap_supp_table(struct file *file, off_t ofs,
     st->writable = writable;
     st->fr = NULL;
     st->pinned = false;
+    st->io_pins = 0;
     
     /* Insert the new entry to the s_table of the process */
-    hash_insert(&(thread_current()->s_table), &st->elem);
+    hash_insert(&(thread_current()->proc->s_table), &st->elem);
     
     return st;
     
 }
 
+/*! Creating a new entry for an asynchronous I/O ring page.  The kernel
+    reads and writes the ring behind the process's back, so the page is
+    pinned for as long as it is mapped. */
+struct supp_table * create_aio_supp_table(void *upage){
+    struct supp_table* st;
+
+    /* Allocate the new supplemental page entry */
+    st =(struct supp_table*) malloc(sizeof(struct supp_table));
+    if (st == NULL)
+        return NULL;
+
+    /* Initialize the fields of the entry */
+    st->type = SPT_AIO;
+    st->file = NULL;
+    st->swap_index = 0;
+    st->upage = upage;
+    st->writable = true;
+    st->fr = NULL;
+    st->pinned = true;
+    st->io_pins = 0;
+
+    /* Insert the new entry to the s_table of the process */
+    hash_insert(&(thread_current()->proc->s_table), &st->elem);
+
+    return st;
+}
+
 /*! The hash function for the supplemental page entry's 
     hash table (s_table) for each process. We use the virtual address
     as the hash key, i.e. upage. */
@@ -148,7 +190,7 @@ bool spte_less_func(struct hash_elem *h1, struct hash_elem *h2,
 /*! Desctructor for the supplemental page entry. */
 void spte_destructor_func(struct hash_elem *h, void *aux UNUSED) {
     struct supp_table *s = hash_entry(h, struct supp_table, elem);
-    hash_delete(&thread_current()->s_table, h);
+    hash_delete(&thread_current()->proc->s_table, h);
 
     if (s->fr) {
         list_remove(&s->fr->elem);
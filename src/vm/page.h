@@ -9,6 +9,7 @@
 #define SPT_NULL 2
 #define SPT_STACK 3
 #define SPT_MMAP 4
+#define SPT_AIO 5
 
 struct supp_table {
    struct file* file;           /*! File to be loaded (if any) */
@@ -21,6 +22,8 @@ struct supp_table {
    uint32_t zero_bytes;         /*! Num of bytes to be set to 0 */
    bool writable;               /*! If the page is writable */
    bool pinned;                 /*! If the page is pinned (non-evictable) */
+   int io_pins;                 /*! Asynchronous I/Os in flight on the page,
+                                    which also keep it from being evicted */
    struct frame_table_entry* fr;    /*! Frame the page is using */
    struct hash_elem elem;       /*! Hash element (for supp-table) */
    struct list_elem map_elem;   /*! List element (for mmap-list) */
@@ -28,6 +31,8 @@ struct supp_table {
 
 
 void supp_table_init(struct hash* s_table);
+void supp_table_lock(void);
+void supp_table_unlock(void);
 struct supp_table * find_supp_table(void *virtual_addr);
 struct supp_table * create_supp_table(struct file *file, off_t ofs, 
                                       uint8_t *upage, uint32_t read_bytes,
@@ -38,6 +43,8 @@ struct supp_table * create_mmap_supp_table(struct file *file, off_t ofs,
                                       void *upage, uint32_t read_bytes,
                                       uint32_t zero_bytes, bool writable);
 
+struct supp_table * create_aio_supp_table(void *upage);
+
 void spte_destructor_func(struct hash_elem *h, void *aux UNUSED);
 
 #endif 
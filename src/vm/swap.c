@@ -23,12 +23,12 @@ void swap_init(void) {
         if (swap_bm)
             bitmap_set_all(swap_bm, 0);
     }
-    lock_init(&swap_lock);
+    lock_init_named(&swap_lock, "swap");
 }
 
 /*! Swap out a frame. */
 size_t swap_out(void *frame) {
-    size_t position, i;
+    size_t position;
 
     if (!swap_block || !swap_bm)    /* Swap block non-existent */
         PANIC("swapping partition not present!\n", 
@@ -40,19 +40,15 @@ size_t swap_out(void *frame) {
     position = bitmap_scan_and_flip(swap_bm, 0, 1, false);
     if (position == BITMAP_ERROR)
         PANIC("no free swapping partition available!\n");
-    for (i = 0; i < SECTORS_PER_PAGE; i++) {
-        /* Write the content of the frame into swap-block */
-        block_write(swap_block, position * SECTORS_PER_PAGE + i,
-                    (uint8_t *)frame + i * BLOCK_SECTOR_SIZE);
-    }
+    /* Write the content of the frame into swap-block */
+    block_write_multiple(swap_block, position * SECTORS_PER_PAGE, frame,
+                         SECTORS_PER_PAGE);
     lock_release(&swap_lock);
     return position;
 }
 
 /*! Swap in a frame. */
 void swap_in(void *frame, size_t position) {
-    size_t i;
-
     if (!swap_block || !swap_bm)    /* Swap block non-existent */
         PANIC("swapping partition not present!\n");
     if (swap_lock.holder != thread_current())
@@ -62,10 +58,8 @@ void swap_in(void *frame, size_t position) {
 
     /* Mark the slot as free */
     bitmap_flip(swap_bm, position);
-    for (i = 0; i < SECTORS_PER_PAGE; i++) {
-        /* Read the content of the swap slot back into the frame */
-        block_read(swap_block, position * SECTORS_PER_PAGE + i,
-                   (uint8_t *)frame + i * BLOCK_SECTOR_SIZE);
-    }
+    /* Read the content of the swap slot back into the frame */
+    block_read_multiple(swap_block, position * SECTORS_PER_PAGE, frame,
+                        SECTORS_PER_PAGE);
     lock_release(&swap_lock);
 }